@@ -0,0 +1,529 @@
+#include "hashlife.h"
+#include "packed.h"
+#include "patternio.h"
+#include "snapshot.h"
+#include "world.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Headless benchmark: runs fixed-seed patterns for a number of generations and prints one JSON
+// object per (pattern, size) run on stdout.
+//
+//   Bench [--pattern random|soup|gliders|guns|all] [--size N|all] [--gens N] [--seed S] [--threads N]
+//         [--kernel scalar|avx2|avx512] [--layout aos|soa] [--rule B3/S23] [--verify N] [--io]
+//
+// --layout soa runs the same pattern on a PackedWorld (structure-of-arrays, Morton ordered, every
+// chunk stepped) instead of the ChunkNode world; population is printed so the two can be compared.
+// It has no dying planes, so it rejects Generations rules ("--rule B2/S/C3").
+//
+// --io measures RLE and Macrocell write and read throughput (MB/s) on each seeded pattern, after
+// --gens generations, instead of stepping. Macrocell is two-state, so under a Generations rule its
+// row reports "ok":false.
+//
+// --verify N skips the benchmark and instead checks every step kernel the CPU supports against
+// StepChunk, and StepChunk against a cell-by-cell count, on N random lane blocks under the chosen
+// rule. It then steps a random --size soup (the first size, 64 by default) for --gens generations
+// in a World and in a cell-by-cell grid, comparing every cell's state, dying states included,
+// after each generation. Last it loads that soup back from a full snapshot and a few deltas, and
+// from a HashLife jump under two-state rules, edits it and checks no chunk is queued twice for the
+// next step. It exits non-zero on any mismatch.
+
+#define MAX_SIZES 8
+
+typedef enum {
+  PATTERN_RANDOM,
+  PATTERN_SOUP,
+  PATTERN_GLIDERS,
+  PATTERN_GUNS,
+  PATTERN_COUNT
+} Pattern;
+
+static const char *PATTERN_NAMES[PATTERN_COUNT] = { "random", "soup", "gliders", "guns" };
+
+static const char *GLIDER[] = {
+  ".O.",
+  "..O",
+  "OOO",
+};
+
+static const char *GOSPER_GUN[] = {
+  "........................O...........",
+  "......................O.O...........",
+  "............OO......OO............OO",
+  "...........O...O....OO............OO",
+  "OO........O.....O...OO..............",
+  "OO........O...O.OO....O.O...........",
+  "..........O.....O.......O...........",
+  "...........O...O....................",
+  "............OO......................",
+};
+
+typedef struct BenchConfig {
+  bool patterns[PATTERN_COUNT];
+  int sizes[MAX_SIZES];
+  int sizeCount;
+  int generations;
+  uint64_t seed;
+  Scheduler *scheduler;
+  bool packed;
+  bool io;
+} BenchConfig;
+
+static uint64_t SplitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long PeakRssKb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static void PlacePattern(World *w, const char *rows[], int rowCount, int64_t x, int64_t y) {
+  for (int row = 0; row < rowCount; row++) {
+    for (int col = 0; rows[row][col]; col++) {
+      if (rows[row][col] == 'O') SetWorldCell(w, x + col, y + row, true);
+    }
+  }
+}
+
+// Fills a whole-chunk aligned rectangle with random cells of roughly 50% density.
+static void FillRandom(World *w, int x0, int y0, int width, int height, uint64_t *rng) {
+  for (int y = y0; y < y0 + height; y += CHUNK_SIZE)
+    for (int x = x0; x < x0 + width; x += CHUNK_SIZE)
+      SetChunkValue(w, x / CHUNK_SIZE, y / CHUNK_SIZE, SplitMix64(rng));
+}
+
+static void SeedPattern(World *w, Pattern pattern, int size, uint64_t seed) {
+  uint64_t rng = seed;
+  switch (pattern) {
+    case PATTERN_RANDOM:
+      FillRandom(w, 0, 0, size, size, &rng);
+      break;
+    case PATTERN_SOUP:
+      // 16x16 soups on a 64-cell lattice, like a batch of independent census soups.
+      for (int y = 0; y < size; y += 64)
+        for (int x = 0; x < size; x += 64)
+          FillRandom(w, x + 24, y + 24, 16, 16, &rng);
+      break;
+    case PATTERN_GLIDERS:
+      for (int y = 0; y < size; y += 16)
+        for (int x = 0; x < size; x += 16)
+          PlacePattern(w, GLIDER, 3, x, y);
+      break;
+    case PATTERN_GUNS:
+      for (int y = 0; y + 9 <= size; y += 64)
+        for (int x = 0; x + 36 <= size; x += 64)
+          PlacePattern(w, GOSPER_GUN, 9, x, y);
+      break;
+    default:
+      break;
+  }
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static double Percentile(const double *sorted, int count, double p) {
+  int i = (int)(p * (count - 1) + 0.5);
+  return sorted[i];
+}
+
+static uint64_t WorldPopulation(const World *w) {
+  uint64_t population = 0;
+  for (uint32_t i = 0; i < w->count; i++) population += __builtin_popcountll(w->nodes[i]->c.chunk_value);
+  return population;
+}
+
+static void RunBench(Pattern pattern, int size, const BenchConfig *cfg) {
+  World world;
+  InitWorld(&world, (uint32_t)((int64_t)size * size / (CHUNK_SIZE * CHUNK_SIZE)) + 64);
+  SeedPattern(&world, pattern, size, cfg->seed);
+  world.scheduler = cfg->scheduler;
+
+  PackedWorld packed;
+  InitPackedWorld(&packed);
+  if (cfg->packed) PackWorld(&packed, &world);
+
+  double *times = malloc(cfg->generations * sizeof(double));
+  uint64_t chunkSteps = 0;
+  double start = NowSeconds();
+  for (int gen = 0; gen < cfg->generations; gen++) {
+    double t = NowSeconds();
+    chunkSteps += cfg->packed ? StepPackedWorld(&packed, cfg->scheduler) : StepWorld(&world);
+    times[gen] = NowSeconds() - t;
+  }
+  double total = NowSeconds() - start;
+
+  qsort(times, cfg->generations, sizeof(double), CompareDoubles);
+  char rule[RULE_TEXT_MAX];
+  FormatRule(GetStepRule(), rule);
+  printf("{\"pattern\":\"%s\",\"size\":%d,\"generations\":%d,\"seed\":%llu,\"threads\":%d,\"kernel\":\"%s\","
+         "\"rule\":\"%s\",\"layout\":\"%s\",\"chunks\":%u,\"population\":%llu,\"chunk_steps\":%llu,\"seconds\":%.6f,"
+         "\"cells_per_sec\":%.0f,\"ns_per_chunk_step\":%.3f,"
+         "\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"peak_rss_kb\":%ld}\n",
+         PATTERN_NAMES[pattern], size, cfg->generations, (unsigned long long)cfg->seed,
+         GetSchedulerThreadCount(cfg->scheduler), GetStepKernelName(GetStepKernel()), rule,
+         cfg->packed ? "soa" : "aos", cfg->packed ? packed.count : world.count,
+         (unsigned long long)(cfg->packed ? GetPackedPopulation(&packed) : WorldPopulation(&world)),
+         (unsigned long long)chunkSteps, total,
+         chunkSteps * 64.0 / total, chunkSteps ? total * 1e9 / chunkSteps : 0.0,
+         Percentile(times, cfg->generations, 0.5) * 1e3,
+         Percentile(times, cfg->generations, 0.99) * 1e3, PeakRssKb());
+  fflush(stdout);
+
+  free(times);
+  FreePackedWorld(&packed);
+  FreeWorld(&world);
+}
+
+typedef struct PatternFormat {
+  const char *name;
+  bool (*write)(const World *w, FILE *out);
+  bool (*read)(World *w, FILE *in, int64_t x, int64_t y, PatternInfo *info);
+} PatternFormat;
+
+static const PatternFormat FORMATS[] = {
+  { "rle", WriteRLE, ReadRLE },
+  { "mc", WriteMacrocell, ReadMacrocell },
+};
+
+static void RunIOBench(Pattern pattern, int size, const BenchConfig *cfg) {
+  World world;
+  InitWorld(&world, (uint32_t)((int64_t)size * size / (CHUNK_SIZE * CHUNK_SIZE)) + 64);
+  SeedPattern(&world, pattern, size, cfg->seed);
+  world.scheduler = cfg->scheduler;
+  for (int gen = 0; gen < cfg->generations; gen++) StepWorld(&world);
+
+  for (size_t f = 0; f < sizeof(FORMATS) / sizeof(FORMATS[0]); f++) {
+    FILE *file = tmpfile();
+    if (!file) return;
+    double start = NowSeconds();
+    bool ok = FORMATS[f].write(&world, file) && fflush(file) == 0;
+    double writeSeconds = NowSeconds() - start;
+    long bytes = ftell(file);
+    rewind(file);
+
+    World loaded;
+    InitWorld(&loaded, 1024);
+    start = NowSeconds();
+    ok = FORMATS[f].read(&loaded, file, 0, 0, NULL) && ok;
+    double readSeconds = NowSeconds() - start;
+    fclose(file);
+
+    printf("{\"pattern\":\"%s\",\"size\":%d,\"generations\":%d,\"seed\":%llu,\"format\":\"%s\","
+           "\"ok\":%s,\"bytes\":%ld,\"population\":%llu,\"write_mb_per_sec\":%.1f,\"read_mb_per_sec\":%.1f,"
+           "\"peak_rss_kb\":%ld}\n",
+           PATTERN_NAMES[pattern], size, cfg->generations, (unsigned long long)cfg->seed, FORMATS[f].name,
+           ok && WorldPopulation(&loaded) == WorldPopulation(&world) ? "true" : "false", bytes,
+           (unsigned long long)WorldPopulation(&loaded), bytes / 1e6 / writeSeconds, bytes / 1e6 / readSeconds,
+           PeakRssKb());
+    fflush(stdout);
+    FreeWorld(&loaded);
+  }
+  FreeWorld(&world);
+}
+
+// Random words with a density picked per case, so both sparse and crowded neighbourhoods are hit.
+static uint64_t RandomWord(uint64_t *rng) {
+  uint64_t value = SplitMix64(rng);
+  switch (SplitMix64(rng) % 4) {
+    case 0: return 0;
+    case 1: return value & SplitMix64(rng) & SplitMix64(rng);
+    case 2: return value;
+    default: return value | SplitMix64(rng);
+  }
+}
+
+// Counts each cell's neighbours one by one over the 24x24 window around the chunk.
+static uint64_t NaiveStep(uint64_t c, const uint64_t n[MAX_NEIGHBOURS], Rule rule) {
+  uint64_t window[3][3] = {
+    { n[NEIGHBOUR_NW], n[NEIGHBOUR_N], n[NEIGHBOUR_NE] },
+    { n[NEIGHBOUR_W], c, n[NEIGHBOUR_E] },
+    { n[NEIGHBOUR_SW], n[NEIGHBOUR_S], n[NEIGHBOUR_SE] },
+  };
+  uint64_t next = 0;
+  for (int y = 0; y < CHUNK_SIZE; y++) {
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+      int count = 0;
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          if (!dx && !dy) continue;
+          int wx = x + dx + CHUNK_SIZE, wy = y + dy + CHUNK_SIZE;
+          count += GetCell(window[wy / CHUNK_SIZE][wx / CHUNK_SIZE], (wy % CHUNK_SIZE) * BLOCK_SIZE + wx % CHUNK_SIZE);
+        }
+      }
+      bool alive = GetCell(c, y * BLOCK_SIZE + x);
+      if ((alive ? rule.survive : rule.birth) & (1u << count)) next |= 1ULL << (y * BLOCK_SIZE + x);
+    }
+  }
+  return next;
+}
+
+static int VerifyKernels(int cases, uint64_t seed) {
+  StepKernel selected = GetStepKernel();
+  int failures = 0;
+  for (int k = 0; k < STEP_KERNEL_COUNT; k++) {
+    if (!SetStepKernel((StepKernel)k)) continue;
+    uint64_t rng = seed;
+    uint64_t mismatches = 0;
+    for (int i = 0; i < cases; i++) {
+      ChunkLanes lanes;
+      uint64_t next[STEP_LANES];
+      for (int l = 0; l < STEP_LANES; l++) {
+        lanes.c[l] = RandomWord(&rng);
+        for (int n = 0; n < MAX_NEIGHBOURS; n++) lanes.n[n][l] = RandomWord(&rng);
+      }
+      StepChunkLanes(&lanes, next);
+      for (int l = 0; l < STEP_LANES; l++) {
+        uint64_t n[MAX_NEIGHBOURS];
+        for (int d = 0; d < MAX_NEIGHBOURS; d++) n[d] = lanes.n[d][l];
+        uint64_t expected = StepChunk(lanes.c[l], n);
+        if (next[l] != expected) mismatches++;
+        if (k == STEP_KERNEL_SCALAR && expected != NaiveStep(lanes.c[l], n, GetStepRule())) mismatches++;
+      }
+    }
+    char rule[RULE_TEXT_MAX];
+    FormatRule(GetStepRule(), rule);
+    printf("{\"verify\":\"%s\",\"rule\":\"%s\",\"cases\":%d,\"seed\":%llu,\"mismatches\":%llu}\n",
+           GetStepKernelName((StepKernel)k), rule, cases, (unsigned long long)seed, (unsigned long long)mismatches);
+    if (mismatches) failures++;
+  }
+  SetStepKernel(selected);
+  return failures ? 1 : 0;
+}
+
+// Cell-by-cell reference for whole worlds: a dense grid of cell states, wide enough that nothing
+// reaches its border in the generations run.
+static void NaiveStepGrid(const uint8_t *cells, uint8_t *next, int side, Rule rule) {
+  for (int y = 0; y < side; y++) {
+    for (int x = 0; x < side; x++) {
+      int count = 0;
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          int nx = x + dx, ny = y + dy;
+          if ((dx || dy) && nx >= 0 && ny >= 0 && nx < side && ny < side) count += cells[ny * side + nx] == 1;
+        }
+      }
+      uint8_t state = cells[y * side + x];
+      if (state == 0) next[y * side + x] = (rule.birth >> count) & 1;
+      else if (state == 1) next[y * side + x] = (rule.survive >> count) & 1 ? 1 : rule.states > 2 ? 2 : 0;
+      else next[y * side + x] = state + 1 < rule.states ? state + 1 : 0;
+    }
+  }
+}
+
+static int VerifyWorld(int size, int generations, uint64_t seed) {
+  World world;
+  InitWorld(&world, 1024);
+  uint64_t rng = seed;
+  size = (size + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+  FillRandom(&world, 0, 0, size, size, &rng);
+
+  int margin = generations + 1, side = size + 2 * margin;
+  uint8_t *cells = calloc((size_t)side * side, 1), *next = calloc((size_t)side * side, 1);
+  for (int y = 0; y < size; y++)
+    for (int x = 0; x < size; x++) cells[(y + margin) * side + x + margin] = (uint8_t)GetWorldCellState(&world, x, y);
+
+  int mismatch = -1, mismatchX = 0, mismatchY = 0;
+  for (int gen = 1; gen <= generations && mismatch < 0; gen++) {
+    StepWorld(&world);
+    NaiveStepGrid(cells, next, side, GetStepRule());
+    uint8_t *swap = cells;
+    cells = next;
+    next = swap;
+    for (int y = 0; y < side && mismatch < 0; y++) {
+      for (int x = 0; x < side; x++) {
+        if (GetWorldCellState(&world, x - margin, y - margin) == cells[y * side + x]) continue;
+        mismatch = gen;
+        mismatchX = x - margin;
+        mismatchY = y - margin;
+        break;
+      }
+    }
+  }
+
+  char rule[RULE_TEXT_MAX], where[64] = "null";
+  FormatRule(GetStepRule(), rule);
+  if (mismatch >= 0)
+    snprintf(where, sizeof(where), "{\"generation\":%d,\"x\":%d,\"y\":%d}", mismatch, mismatchX, mismatchY);
+  printf("{\"verify\":\"world\",\"rule\":\"%s\",\"size\":%d,\"generations\":%d,\"seed\":%llu,\"mismatch\":%s}\n", rule,
+         size, generations, (unsigned long long)seed, where);
+  free(cells);
+  free(next);
+  FreeWorld(&world);
+  return mismatch < 0 ? 0 : 1;
+}
+
+static int ComparePointers(const void *a, const void *b) {
+  uintptr_t x = (uintptr_t)*(void *const *)a, y = (uintptr_t)*(void *const *)b;
+  return (x > y) - (x < y);
+}
+
+// Chunks queued more than once for the next step; the scheduler would commit each of them twice.
+static uint32_t CountDuplicateActive(const World *w) {
+  ChunkNode **sorted = malloc((w->active.count + 1) * sizeof(ChunkNode *));
+  memcpy(sorted, w->active.items, w->active.count * sizeof(ChunkNode *));
+  qsort(sorted, w->active.count, sizeof(ChunkNode *), ComparePointers);
+  uint32_t duplicates = 0;
+  for (uint32_t i = 1; i < w->active.count; i++) duplicates += sorted[i] == sorted[i - 1];
+  free(sorted);
+  return duplicates;
+}
+
+static int VerifySnapshotLoad(int size, uint64_t seed) {
+  World world, loaded;
+  InitWorld(&world, 1024);
+  InitWorld(&loaded, 1024);
+  uint64_t rng = seed;
+  size = (size + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+  FillRandom(&world, 0, 0, size, size, &rng);
+
+  char path[] = "/tmp/bench-verify-XXXXXX";
+  int fd = mkstemp(path);
+  bool ok = fd >= 0;
+  if (ok) close(fd);
+  ok = ok && SaveWorldSnapshot(&world, path);
+  for (int i = 0; i < 3 && ok; i++) {
+    for (int gen = 0; gen < 5; gen++) StepWorld(&world);
+    ok = AppendWorldCheckpoint(&world, path);
+  }
+  ok = ok && LoadWorldSnapshot(&loaded, path) && HashWorld(&loaded) == HashWorld(&world);
+  if (fd >= 0) unlink(path);
+
+  // Edits land in chunks the load already queued.
+  for (int i = 0; i < 64; i++) SetWorldCell(&loaded, (int64_t)(SplitMix64(&rng) % size), (int64_t)(SplitMix64(&rng) % size), true);
+  uint32_t duplicates = CountDuplicateActive(&loaded);
+
+  uint32_t jumpDuplicates = 0;
+  if (!world.planes) {
+    HashLife hl;
+    InitHashLife(&hl, (size_t)64 << 20);
+    LoadHashLifeFromWorld(&hl, &world);
+    JumpHashLife(&hl, 4);
+    ClearWorld(&loaded);
+    StoreHashLifeToWorld(&hl, &loaded);
+    FreeHashLife(&hl);
+    for (int i = 0; i < 64; i++) SetWorldCell(&loaded, (int64_t)(SplitMix64(&rng) % size), (int64_t)(SplitMix64(&rng) % size), true);
+    jumpDuplicates = CountDuplicateActive(&loaded);
+  }
+
+  printf("{\"verify\":\"snapshot\",\"size\":%d,\"seed\":%llu,\"loaded\":%s,\"duplicates\":%u,\"jumpDuplicates\":%u}\n",
+         size, (unsigned long long)seed, ok ? "true" : "false", duplicates, jumpDuplicates);
+  FreeWorld(&world);
+  FreeWorld(&loaded);
+  return ok && !duplicates && !jumpDuplicates ? 0 : 1;
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [--pattern random|soup|gliders|guns|all] [--size N|all] [--gens N] [--seed S] [--threads N]\n"
+                  "          [--kernel scalar|avx2|avx512] [--layout aos|soa] [--rule B3/S23] [--verify N] [--io]\n", name);
+}
+
+int main(int argc, char **argv) {
+  BenchConfig cfg = { .generations = 100, .seed = 1 };
+  static const int ALL_SIZES[] = { 64, 256, 1024, 4096, 16384 };
+  bool anyPattern = false;
+  int threads = 0;
+  int verifyCases = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--pattern") == 0 && value) {
+      for (int p = 0; p < PATTERN_COUNT; p++)
+        if (strcmp(value, "all") == 0 || strcmp(value, PATTERN_NAMES[p]) == 0) cfg.patterns[p] = anyPattern = true;
+      i++;
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      if (strcmp(value, "all") != 0 && cfg.sizeCount < MAX_SIZES) cfg.sizes[cfg.sizeCount++] = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--gens") == 0 && value) {
+      cfg.generations = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      threads = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      cfg.seed = strtoull(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--kernel") == 0 && value) {
+      int k = 0;
+      while (k < STEP_KERNEL_COUNT && strcmp(value, GetStepKernelName((StepKernel)k)) != 0) k++;
+      if (!SetStepKernel((StepKernel)k)) {
+        fprintf(stderr, "step kernel '%s' is not supported on this CPU\n", value);
+        return 1;
+      }
+      i++;
+    } else if (strcmp(arg, "--layout") == 0 && value) {
+      if (strcmp(value, "soa") != 0 && strcmp(value, "aos") != 0) {
+        Usage(argv[0]);
+        return 1;
+      }
+      cfg.packed = strcmp(value, "soa") == 0;
+      i++;
+    } else if (strcmp(arg, "--rule") == 0 && value) {
+      Rule rule;
+      if (!ParseRule(value, &rule)) {
+        fprintf(stderr, "invalid rule '%s' (B0 rules are not supported)\n", value);
+        return 1;
+      }
+      SetStepRule(rule);
+      i++;
+    } else if (strcmp(arg, "--io") == 0) {
+      cfg.io = true;
+    } else if (strcmp(arg, "--verify") == 0 && value) {
+      verifyCases = atoi(value);
+      i++;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (verifyCases > 0) {
+    int size = cfg.sizeCount ? cfg.sizes[0] : 64;
+    int status = VerifyKernels(verifyCases, cfg.seed);
+    status |= VerifyWorld(size, cfg.generations, cfg.seed);
+    return VerifySnapshotLoad(size, cfg.seed) || status;
+  }
+  if (cfg.packed && GetStepRule().states > 2) {
+    fprintf(stderr, "--layout soa only supports two-state rules\n");
+    return 1;
+  }
+
+  if (!anyPattern)
+    for (int p = 0; p < PATTERN_COUNT; p++) cfg.patterns[p] = true;
+  if (cfg.sizeCount == 0) {
+    for (int s = 0; s < (int)(sizeof(ALL_SIZES) / sizeof(ALL_SIZES[0])); s++) cfg.sizes[cfg.sizeCount++] = ALL_SIZES[s];
+  }
+  if (cfg.generations <= 0) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  // --threads 1 measures the plain single-threaded path.
+  cfg.scheduler = threads == 1 ? NULL : CreateScheduler(threads);
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    if (!cfg.patterns[p]) continue;
+    for (int s = 0; s < cfg.sizeCount; s++) (cfg.io ? RunIOBench : RunBench)((Pattern)p, cfg.sizes[s], &cfg);
+  }
+  DestroyScheduler(cfg.scheduler);
+  return 0;
+}
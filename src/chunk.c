@@ -0,0 +1,205 @@
+#include "chunk.h"
+
+#include <string.h>
+
+const int NEIGHBOUR_DX[MAX_NEIGHBOURS] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const int NEIGHBOUR_DY[MAX_NEIGHBOURS] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// Cells of a chunk that touch the neighbour in each direction.
+const uint64_t NEIGHBOUR_EDGE[MAX_NEIGHBOURS] = {
+  0x00000000000000FFULL, 0x0000000000000080ULL, COLUMN_EAST, 0x8000000000000000ULL,
+  0xFF00000000000000ULL, 0x0100000000000000ULL, COLUMN_WEST, 0x0000000000000001ULL,
+};
+
+int GetCell(uint64_t value, int cell) {
+  return (value >> cell) & 1;  // Shift and mask the cell
+}
+
+static Rule currentRule = RULE_LIFE;
+
+// Neighbour counts arrive as bit-planes; EQ(k) is set where the count is exactly k. With constant
+// masks RULE_APPLY folds down to the handful of terms the rule uses, so a specialised kernel has no
+// per-cell branches. With runtime masks every term is kept but ANDed with 0 or ~0, still branchless.
+#define RULE_EQ(k) ((((k) & 1) ? ones : ~ones) & (((k) & 2) ? twos : ~twos) & \
+                    (((k) & 4) ? fours : ~fours) & (((k) & 8) ? eights : ~eights))
+#define RULE_TERM(mask, k) (RULE_EQ(k) & (0 - (uint64_t)(((mask) >> (k)) & 1)))
+#define RULE_COUNTS(mask) (RULE_TERM(mask, 0) | RULE_TERM(mask, 1) | RULE_TERM(mask, 2) |       \
+                           RULE_TERM(mask, 3) | RULE_TERM(mask, 4) | RULE_TERM(mask, 5) |       \
+                           RULE_TERM(mask, 6) | RULE_TERM(mask, 7) | RULE_TERM(mask, 8))
+#define RULE_APPLY(c, birth, survive) ((~(c) & RULE_COUNTS(birth)) | ((c) & RULE_COUNTS(survive)))
+
+// The step arithmetic as macros, so the same body compiles for a plain uint64_t and for GCC/Clang
+// vector types. Only shifts and bitwise operations are used, which is why every width produces
+// identical bits. Each LANE_ shift gives every cell its neighbour in that direction, pulling the
+// missing edge from the adjacent chunk, and the eight neighbour words are summed with a full-adder
+// tree into count bit-planes.
+#define LANE_WEST(c, w) ((((c) << 1) & ~COLUMN_WEST) | (((w) >> 7) & COLUMN_WEST))
+#define LANE_EAST(c, e) ((((c) >> 1) & ~COLUMN_EAST) | (((e) << 7) & COLUMN_EAST))
+#define LANE_NORTH(c, n) (((c) << 8) | ((n) >> 56))
+#define LANE_SOUTH(c, s) (((c) >> 8) | ((s) << 56))
+
+#define STEP_BODY(T, c, n, birth, survive, next)                                               \
+  T up = LANE_NORTH(c, n[NEIGHBOUR_N]);                                                        \
+  T down = LANE_SOUTH(c, n[NEIGHBOUR_S]);                                                      \
+  T upWest = LANE_NORTH(n[NEIGHBOUR_W], n[NEIGHBOUR_NW]);                                      \
+  T upEast = LANE_NORTH(n[NEIGHBOUR_E], n[NEIGHBOUR_NE]);                                      \
+  T downWest = LANE_SOUTH(n[NEIGHBOUR_W], n[NEIGHBOUR_SW]);                                    \
+  T downEast = LANE_SOUTH(n[NEIGHBOUR_E], n[NEIGHBOUR_SE]);                                    \
+  T a0 = LANE_WEST(up, upWest), b0 = LANE_EAST(up, upEast);                                   \
+  T a1 = LANE_WEST(down, downWest), b1 = LANE_EAST(down, downEast);                           \
+  T west = LANE_WEST(c, n[NEIGHBOUR_W]), east = LANE_EAST(c, n[NEIGHBOUR_E]);                 \
+  T t0 = a0 ^ up, s0 = t0 ^ b0, c0 = (a0 & up) | (t0 & b0);                                   \
+  T t1 = a1 ^ down, s1 = t1 ^ b1, c1 = (a1 & down) | (t1 & b1);                               \
+  T s2 = west ^ east, c2 = west & east;                                                        \
+  T t2 = s0 ^ s1, ones = t2 ^ s2, c3 = (s0 & s1) | (t2 & s2);                                 \
+  T t3 = c0 ^ c1, t = t3 ^ c2, c4 = (c0 & c1) | (t3 & c2);                                    \
+  T twos = t ^ c3, fours = c4 ^ (t & c3), eights = c4 & t & c3;                                \
+  T next = RULE_APPLY(c, birth, survive);
+
+// The kernels only see the live plane, so a Generations rule steps with its B/S counts' kernel.
+static bool SameCounts(Rule a, Rule b) {
+  return a.birth == b.birth && a.survive == b.survive;
+}
+
+uint64_t StepChunk(uint64_t c, const uint64_t n[MAX_NEIGHBOURS]) {
+  if (SameCounts(currentRule, RULE_LIFE)) {
+    STEP_BODY(uint64_t, c, n, 0x008, 0x00C, next)
+    return next;
+  }
+  STEP_BODY(uint64_t, c, n, currentRule.birth, currentRule.survive, next)
+  return next;
+}
+
+#define DEFINE_STEP_LANES(name, T, width, attributes, birth, survive)                          \
+  static attributes void name(const ChunkLanes *in, uint64_t out[STEP_LANES]) {             \
+    for (int i = 0; i < STEP_LANES; i += (width)) {                                           \
+      T c, n[MAX_NEIGHBOURS];                                                                  \
+      memcpy(&c, in->c + i, sizeof(T));                                                        \
+      for (int k = 0; k < MAX_NEIGHBOURS; k++) memcpy(&n[k], in->n[k] + i, sizeof(T));        \
+      STEP_BODY(T, c, n, birth, survive, next)                                                 \
+      memcpy(out + i, &next, sizeof(T));                                                       \
+    }                                                                                          \
+  }
+
+// Rules with their own kernels; anything else runs the generic kernel, which reads currentRule.
+#define SPECIALISED_RULES(X)                                                                   \
+  X(Life, 0x008, 0x00C)             /* B3/S23 */                                               \
+  X(HighLife, 0x048, 0x00C)         /* B36/S23 */                                              \
+  X(Seeds, 0x004, 0x000)            /* B2/S */                                                 \
+  X(DayAndNight, 0x1C8, 0x1D8)      /* B3678/S34678 */                                         \
+  X(LifeWithoutDeath, 0x008, 0x1FF) /* B3/S012345678 */                                        \
+  X(Maze, 0x008, 0x03E)             /* B3/S12345 */                                            \
+  X(TwoByTwo, 0x048, 0x026)         /* B36/S125 */                                             \
+  X(Replicator, 0x0AA, 0x0AA)       /* B1357/S1357 */                                          \
+  X(Diamoeba, 0x1E8, 0x1E0)         /* B35678/S5678 */                                         \
+  X(Morley, 0x148, 0x034)           /* B368/S245 */                                            \
+  X(Anneal, 0x1D0, 0x1E8)           /* B4678/S35678 */                                         \
+  X(Coral, 0x008, 0x1F0)            /* B3/S45678 */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_X86_KERNELS 1
+typedef uint64_t U64x4 __attribute__((vector_size(32)));
+typedef uint64_t U64x8 __attribute__((vector_size(64)));
+#define DEFINE_RULE_KERNELS(name, birth, survive)                                              \
+  DEFINE_STEP_LANES(StepLanes##name##Scalar, uint64_t, 1, , birth, survive)                    \
+  DEFINE_STEP_LANES(StepLanes##name##Avx2, U64x4, 4, __attribute__((target("avx2"))), birth, survive) \
+  DEFINE_STEP_LANES(StepLanes##name##Avx512, U64x8, 8, __attribute__((target("avx512f"))), birth, survive)
+#define RULE_KERNEL_ROW(name, birth, survive) \
+  { StepLanes##name##Scalar, StepLanes##name##Avx2, StepLanes##name##Avx512 },
+#else
+#define DEFINE_RULE_KERNELS(name, birth, survive) \
+  DEFINE_STEP_LANES(StepLanes##name##Scalar, uint64_t, 1, , birth, survive)
+#define RULE_KERNEL_ROW(name, birth, survive) \
+  { StepLanes##name##Scalar, StepLanes##name##Scalar, StepLanes##name##Scalar },
+#endif
+
+SPECIALISED_RULES(DEFINE_RULE_KERNELS)
+DEFINE_RULE_KERNELS(Generic, currentRule.birth, currentRule.survive)
+
+typedef void (*StepLanesFn)(const ChunkLanes *in, uint64_t out[STEP_LANES]);
+
+#define RULE_ENTRY(name, birth, survive) { birth, survive, 2 },
+static const Rule SPECIALISED[] = { SPECIALISED_RULES(RULE_ENTRY) };
+#define SPECIALISED_COUNT (sizeof(SPECIALISED) / sizeof(SPECIALISED[0]))
+
+// One row per specialised rule plus the generic row last, one column per StepKernel.
+static const StepLanesFn STEP_LANES_TABLE[SPECIALISED_COUNT + 1][STEP_KERNEL_COUNT] = {
+  SPECIALISED_RULES(RULE_KERNEL_ROW)
+  RULE_KERNEL_ROW(Generic, 0, 0)
+};
+
+static StepKernel currentKernel = STEP_KERNEL_SCALAR;
+static uint32_t currentRuleRow = 0;
+static StepLanesFn currentStepLanes = StepLanesLifeScalar;
+
+static const char *STEP_KERNEL_NAMES[STEP_KERNEL_COUNT] = { "scalar", "avx2", "avx512" };
+
+void StepChunkLanes(const ChunkLanes *in, uint64_t out[STEP_LANES]) {
+  currentStepLanes(in, out);
+}
+
+Rule GetStepRule(void) {
+  return currentRule;
+}
+
+bool IsStepRuleSpecialised(void) {
+  return currentRuleRow < SPECIALISED_COUNT;
+}
+
+void SetStepRule(Rule rule) {
+  currentRule = rule;
+  currentRuleRow = SPECIALISED_COUNT;
+  for (uint32_t i = 0; i < SPECIALISED_COUNT; i++)
+    if (SameCounts(SPECIALISED[i], rule)) currentRuleRow = i;
+  currentStepLanes = STEP_LANES_TABLE[currentRuleRow][currentKernel];
+}
+
+void AdvanceDyingPlanes(uint64_t *planes, int planeCount, int states, uint64_t live, uint64_t next) {
+  uint64_t dying = 0;
+  for (int p = 0; p < planeCount; p++) dying |= planes[p];
+
+  // Add one to every dying cell's age, then clear the cells that have reached the last state.
+  uint64_t carry = dying, expired = dying;
+  for (int p = 0; p < planeCount; p++) {
+    uint64_t overflow = planes[p] & carry;
+    planes[p] ^= carry;
+    carry = overflow;
+    expired &= ((states - 1) >> p) & 1 ? planes[p] : ~planes[p];
+  }
+  for (int p = 0; p < planeCount; p++) planes[p] &= ~expired;
+
+  // Live cells that do not survive start dying at age 1.
+  if (planeCount > 0) planes[0] |= live & ~next;
+}
+
+bool IsStepKernelSupported(StepKernel kernel) {
+  switch (kernel) {
+    case STEP_KERNEL_SCALAR: return true;
+#ifdef HAVE_X86_KERNELS
+    case STEP_KERNEL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+    case STEP_KERNEL_AVX512: __builtin_cpu_init(); return __builtin_cpu_supports("avx512f");
+#endif
+    default: return false;
+  }
+}
+
+StepKernel GetStepKernel(void) {
+  return currentKernel;
+}
+
+bool SetStepKernel(StepKernel kernel) {
+  if (!IsStepKernelSupported(kernel)) return false;
+  currentKernel = kernel;
+  currentStepLanes = STEP_LANES_TABLE[currentRuleRow][currentKernel];
+  return true;
+}
+
+const char *GetStepKernelName(StepKernel kernel) {
+  return kernel >= 0 && kernel < STEP_KERNEL_COUNT ? STEP_KERNEL_NAMES[kernel] : "unknown";
+}
+
+__attribute__((constructor)) static void SelectStepKernel(void) {
+  for (int k = STEP_KERNEL_COUNT - 1; k > STEP_KERNEL_SCALAR; k--) {
+    if (SetStepKernel((StepKernel)k)) return;
+  }
+}
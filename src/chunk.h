@@ -0,0 +1,134 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include "rule.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef union Block Block;
+union Block {
+  struct {
+    uint8_t a : 1;
+    uint8_t b : 1;
+    uint8_t c : 1;
+    uint8_t d : 1;
+    uint8_t e : 1;
+    uint8_t f : 1;
+    uint8_t g : 1;
+    uint8_t h : 1;
+  } cells;
+  unsigned char block_value;
+};
+
+#define CHUNK_SIZE 8
+#define BLOCK_SIZE 8
+
+typedef union Chunk Chunk;
+union Chunk {
+  struct {
+    Block a;
+    Block b;
+    Block c;
+    Block d;
+    Block e;
+    Block f;
+    Block g;
+    Block h;
+  } blocks;
+  uint64_t chunk_value;
+};
+
+#define MAX_NEIGHBOURS 8
+
+// Neighbour slots, clockwise from north. y grows downwards like the screen.
+typedef enum {
+  NEIGHBOUR_N,
+  NEIGHBOUR_NE,
+  NEIGHBOUR_E,
+  NEIGHBOUR_SE,
+  NEIGHBOUR_S,
+  NEIGHBOUR_SW,
+  NEIGHBOUR_W,
+  NEIGHBOUR_NW
+} Neighbour;
+
+// Bit (row * BLOCK_SIZE + col) is the cell at (col, row): << 1 moves cells east, << 8 moves them south.
+#define COLUMN_WEST 0x0101010101010101ULL
+#define COLUMN_EAST 0x8080808080808080ULL
+
+extern const int NEIGHBOUR_DX[MAX_NEIGHBOURS];
+extern const int NEIGHBOUR_DY[MAX_NEIGHBOURS];
+extern const uint64_t NEIGHBOUR_EDGE[MAX_NEIGHBOURS];
+
+#define OPPOSITE(n) (((n) + 4) % MAX_NEIGHBOURS)
+
+static inline uint64_t SpreadBits(uint32_t v) {
+  uint64_t x = v;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+  x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x << 2)) & 0x3333333333333333ULL;
+  x = (x | (x << 1)) & 0x5555555555555555ULL;
+  return x;
+}
+
+static inline uint32_t CompactBits(uint64_t x) {
+  x &= 0x5555555555555555ULL;
+  x = (x | (x >> 1)) & 0x3333333333333333ULL;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+  return (uint32_t)x;
+}
+
+// Z-order (Morton) key of chunk coordinates: every aligned 2^k x 2^k square of chunks is one
+// contiguous key range. Coordinates are biased to unsigned so the curve is continuous across zero.
+static inline uint64_t MortonKey(int32_t x, int32_t y) {
+  return SpreadBits((uint32_t)x ^ 0x80000000u) | (SpreadBits((uint32_t)y ^ 0x80000000u) << 1);
+}
+
+int GetCell(uint64_t value, int cell);
+// Advances one chunk a generation under the current step rule.
+uint64_t StepChunk(uint64_t c, const uint64_t n[MAX_NEIGHBOURS]);
+
+// Batched step: STEP_LANES independent chunks laid out structure-of-arrays, so a SIMD kernel
+// can load each neighbour direction for several chunks with one instruction.
+#define STEP_LANES 8
+
+typedef struct ChunkLanes {
+  uint64_t c[STEP_LANES];
+  uint64_t n[MAX_NEIGHBOURS][STEP_LANES];
+} ChunkLanes;
+
+typedef enum {
+  STEP_KERNEL_SCALAR,
+  STEP_KERNEL_AVX2,
+  STEP_KERNEL_AVX512,
+  STEP_KERNEL_COUNT
+} StepKernel;
+
+// Steps every lane with the selected kernel; all kernels give the same result as StepChunk.
+void StepChunkLanes(const ChunkLanes *in, uint64_t out[STEP_LANES]);
+
+// Ages the dying cells of a Generations rule by one generation. planes[] holds each cell's age
+// (state - 1) in binary, one bit per plane, and is zero for live and dead cells; live and next
+// are the live planes before and after the step.
+void AdvanceDyingPlanes(uint64_t *planes, int planeCount, int states, uint64_t live, uint64_t next);
+
+// The best kernel the CPU supports is selected at startup. SetStepKernel returns false (and
+// changes nothing) if the CPU lacks the instructions; it is not safe to call while stepping.
+StepKernel GetStepKernel(void);
+bool SetStepKernel(StepKernel kernel);
+bool IsStepKernelSupported(StepKernel kernel);
+const char *GetStepKernelName(StepKernel kernel);
+
+// The rule every step function applies, B3/S23 by default. Common rules have kernels specialised
+// at compile time; others use a generic kernel. Set it before stepping starts: memoised HashLife
+// results are only valid for the rule they were computed under.
+Rule GetStepRule(void);
+void SetStepRule(Rule rule);
+bool IsStepRuleSpecialised(void);
+
+#endif
@@ -0,0 +1,102 @@
+#include "chunkpool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The header takes the first cache line of every slab, so slots stay line-aligned.
+struct ChunkPage {
+  ChunkPage *nextAvailable;
+  void *freeList; // Freed slots, linked through their first word
+  uint32_t fresh; // Slots never handed out start at this index
+  bool onAvailable;
+};
+
+_Static_assert(sizeof(ChunkPage) <= CHUNK_POOL_LINE_SIZE, "slab header must fit one cache line");
+
+static inline ChunkPage *PageOf(const void *slot) {
+  return (ChunkPage *)((uintptr_t)slot & ~(uintptr_t)(CHUNK_POOL_PAGE_SIZE - 1));
+}
+
+static inline void *SlotAt(const ChunkPool *pool, ChunkPage *page, uint32_t i) {
+  return (char *)page + CHUNK_POOL_LINE_SIZE + (size_t)i * pool->slotSize;
+}
+
+static inline bool PageHasRoom(const ChunkPool *pool, const ChunkPage *page) {
+  return page->freeList != NULL || page->fresh < pool->slotsPerPage;
+}
+
+static void PushAvailable(ChunkPool *pool, ChunkPage *page) {
+  if (page->onAvailable) return;
+  page->onAvailable = true;
+  page->nextAvailable = pool->available;
+  pool->available = page;
+}
+
+void InitChunkPool(ChunkPool *pool, size_t objectSize) {
+  size_t slotSize = (objectSize + CHUNK_POOL_LINE_SIZE - 1) & ~(size_t)(CHUNK_POOL_LINE_SIZE - 1);
+  *pool = (ChunkPool){
+    .slotSize = slotSize,
+    .slotsPerPage = (uint32_t)((CHUNK_POOL_PAGE_SIZE - CHUNK_POOL_LINE_SIZE) / slotSize),
+  };
+}
+
+void FreeChunkPool(ChunkPool *pool) {
+  for (uint32_t i = 0; i < pool->stats.pages; i++) free(pool->pages[i]);
+  free(pool->pages);
+  *pool = (ChunkPool){ 0 };
+}
+
+void ResetChunkPool(ChunkPool *pool) {
+  pool->available = NULL;
+  for (uint32_t i = 0; i < pool->stats.pages; i++) {
+    ChunkPage *page = pool->pages[i];
+    *page = (ChunkPage){ 0 };
+    PushAvailable(pool, page);
+  }
+  pool->stats.live = 0;
+}
+
+static ChunkPage *NewPage(ChunkPool *pool) {
+  if (pool->stats.pages == pool->pageCapacity) {
+    pool->pageCapacity = pool->pageCapacity ? pool->pageCapacity * 2 : 16;
+    pool->pages = realloc(pool->pages, pool->pageCapacity * sizeof(ChunkPage *));
+  }
+  ChunkPage *page = aligned_alloc(CHUNK_POOL_PAGE_SIZE, CHUNK_POOL_PAGE_SIZE);
+  *page = (ChunkPage){ 0 };
+  pool->pages[pool->stats.pages++] = page;
+  PushAvailable(pool, page);
+  return page;
+}
+
+void *AllocChunkSlot(ChunkPool *pool, const void *hint) {
+  ChunkPage *page = hint ? PageOf(hint) : NULL;
+  if (!page || !PageHasRoom(pool, page)) {
+    // Full slabs are dropped from the available list lazily, when they reach its head.
+    while (pool->available && !PageHasRoom(pool, pool->available)) {
+      pool->available->onAvailable = false;
+      pool->available = pool->available->nextAvailable;
+    }
+    page = pool->available ? pool->available : NewPage(pool);
+  }
+
+  void *slot;
+  if (page->freeList) {
+    slot = page->freeList;
+    page->freeList = *(void **)slot;
+    pool->stats.recycled++;
+  } else {
+    slot = SlotAt(pool, page, page->fresh++);
+  }
+  if (++pool->stats.live > pool->stats.peak) pool->stats.peak = pool->stats.live;
+  pool->stats.allocations++;
+  memset(slot, 0, pool->slotSize);
+  return slot;
+}
+
+void FreeChunkSlot(ChunkPool *pool, void *slot) {
+  ChunkPage *page = PageOf(slot);
+  *(void **)slot = page->freeList;
+  page->freeList = slot;
+  pool->stats.live--;
+  PushAvailable(pool, page);
+}
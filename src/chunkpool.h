@@ -0,0 +1,42 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Slab allocator for fixed-size chunk nodes. Slots live in page-aligned slabs and are padded to
+// whole cache lines; freed slots go back on their slab's free list. Allocation takes a hint (a
+// spatial neighbour) and prefers a slot in the hint's slab, so nearby chunks end up next to each
+// other in memory.
+#define CHUNK_POOL_PAGE_SIZE 16384
+#define CHUNK_POOL_LINE_SIZE 64
+
+typedef struct ChunkPage ChunkPage;
+
+typedef struct ChunkPoolStats {
+  uint32_t live;
+  uint32_t peak;
+  uint64_t allocations; // Every slot handed out so far
+  uint64_t recycled; // Allocations served from a free list rather than a fresh slot
+  uint32_t pages;
+} ChunkPoolStats;
+
+typedef struct ChunkPool {
+  size_t slotSize;
+  uint32_t slotsPerPage;
+  ChunkPage **pages;
+  uint32_t pageCapacity;
+  ChunkPage *available; // Slabs that may still have room, most recently touched first
+  ChunkPoolStats stats;
+} ChunkPool;
+
+void InitChunkPool(ChunkPool *pool, size_t objectSize);
+void FreeChunkPool(ChunkPool *pool);
+// Returns every slot to the pool but keeps the slabs.
+void ResetChunkPool(ChunkPool *pool);
+// Returns a zeroed slot; hint may be NULL or any live object from this pool.
+void *AllocChunkSlot(ChunkPool *pool, const void *hint);
+void FreeChunkSlot(ChunkPool *pool, void *slot);
+
+#endif
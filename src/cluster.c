@@ -0,0 +1,435 @@
+#include "halo.h"
+#include "patternio.h"
+#include "world.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Headless run of one world split across processes by a halo exchange (see halo.h). Its output
+// matches Replay's for the same soup or pattern, hash for hash.
+//
+//   Cluster [--ranks N] [--strip W] [--seed S] [--size N] [--pattern file.rle|file.mc] [--rule B3/S23]
+//           [--gens N] [--every N] [--threads N] [--kernel scalar|avx2|avx512] [--expect HASH]
+//           [--rank R --port P [--hosts host0,host1,...]]
+//
+// By default it forks --ranks processes on this host, chained by Unix socket pairs. With --rank it
+// runs that one rank over TCP instead: rank r listens on port P + r for its east neighbour and
+// connects to its west neighbour on hosts[r - 1], port P + r - 1 (hosts default to 127.0.0.1).
+// Start every rank with the same arguments apart from --rank, in any order.
+//
+// Rank r owns the chunk columns [x + r * W, x + (r + 1) * W), the first and last strips open-ended,
+// where x is the pattern's first column (0 for a soup) and W defaults to the pattern's width in
+// chunks over the rank count. Every rank reads the whole pattern and keeps its strip. Rank 0 prints
+// the checkpoints, summed over the ranks along the chain:
+//
+//   {"generation":100,"hash":"0x...","population":1234,"chunks":56}
+//
+// then a summary with the halo traffic and the time the ranks spent waiting for their peers once
+// their interior was stepped. chunks counts the chunks the ranks own.
+
+#define CLUSTER_CONNECT_SECONDS 30
+
+typedef struct ClusterConfig {
+  uint64_t seed;
+  int size;
+  const char *pattern;
+  bool ruleGiven;
+  int generations;
+  int every;
+  bool hasExpected;
+  uint64_t expected;
+  int threads;
+  int ranks;
+  int strip;
+  int rank; // -1 forks every rank locally
+  int port;
+  const char *hosts;
+} ClusterConfig;
+
+// Checkpoint sums.
+enum { SUM_HASH, SUM_POPULATION, SUM_CHUNKS, CHECKPOINT_SUMS };
+// Summary sums, after the checkpoint ones.
+enum { SUM_MESSAGES = CHECKPOINT_SUMS, SUM_EDGE_CHUNKS, SUM_BYTES, SUM_WAIT_MICROSECONDS, SUMMARY_SUMS };
+
+static uint64_t SplitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool ReadPatternFile(World *w, const char *path, PatternInfo *info) {
+  FILE *in = fopen(path, "rb");
+  if (!in) return false;
+  size_t length = strlen(path);
+  bool macrocell = length > 3 && strcmp(path + length - 3, ".mc") == 0;
+  bool ok = (macrocell ? ReadMacrocell : ReadRLE)(w, in, 0, 0, info);
+  fclose(in);
+  return ok;
+}
+
+// Reads the whole pattern into source, switching to the file's rule first unless one was given.
+static bool LoadSource(World *source, const ClusterConfig *cfg) {
+  PatternInfo info;
+  InitWorld(source, 1024);
+  if (!ReadPatternFile(source, cfg->pattern, &info)) return false;
+  Rule rule;
+  if (cfg->ruleGiven || !info.rule[0] || !ParseRule(info.rule, &rule) || RulesEqual(rule, GetStepRule())) return true;
+  FreeWorld(source);
+  SetStepRule(rule);
+  InitWorld(source, 1024);
+  return ReadPatternFile(source, cfg->pattern, NULL);
+}
+
+static void CopyStrip(World *w, const World *source) {
+  for (uint32_t i = 0; i < source->count; i++) {
+    const ChunkNode *node = source->nodes[i];
+    if (!IsHaloColumnOwned(w->halo, node->x) || (!node->c.chunk_value && !GetDyingCells(source, node))) continue;
+    ChunkNode *copy = GetOrCreateChunk(w, node->x, node->y);
+    copy->c = node->c;
+    memcpy(copy->dying, node->dying, w->planes * sizeof(uint64_t));
+    WakeChunk(w, copy);
+  }
+}
+
+// The same soup as Replay's, with the chunks outside the strip skipped.
+static void SeedStrip(World *w, int size, uint64_t seed) {
+  uint64_t rng = seed;
+  int chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  for (int y = 0; y < chunks; y++) {
+    for (int x = 0; x < chunks; x++) {
+      uint64_t value = SplitMix64(&rng);
+      if (IsHaloColumnOwned(w->halo, x)) SetChunkValue(w, x, y, value);
+    }
+  }
+}
+
+static void GetCheckpointSums(const World *w, uint64_t *sums) {
+  sums[SUM_HASH] = HashWorld(w);
+  sums[SUM_POPULATION] = sums[SUM_CHUNKS] = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!IsHaloColumnOwned(w->halo, node->x)) continue;
+    sums[SUM_POPULATION] += __builtin_popcountll(node->c.chunk_value);
+    sums[SUM_CHUNKS]++;
+  }
+}
+
+static bool Checkpoint(World *w) {
+  uint64_t sums[CHECKPOINT_SUMS];
+  GetCheckpointSums(w, sums);
+  if (!ReduceHalo(w->halo, w->generation, sums, CHECKPOINT_SUMS)) return false;
+  if (w->halo->rank == 0) {
+    printf("{\"generation\":%llu,\"hash\":\"0x%016llx\",\"population\":%llu,\"chunks\":%llu}\n",
+           (unsigned long long)w->generation, (unsigned long long)sums[SUM_HASH],
+           (unsigned long long)sums[SUM_POPULATION], (unsigned long long)sums[SUM_CHUNKS]);
+  }
+  return true;
+}
+
+// Runs one rank to the end and returns its exit status.
+static int RunRank(const ClusterConfig *cfg, int rank, int westFd, int eastFd, const char *transport) {
+  double wallStart = NowSeconds();
+  World source = { 0 };
+  int origin = 0, width = (cfg->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if (cfg->pattern) {
+    if (!LoadSource(&source, cfg)) {
+      fprintf(stderr, "rank %d: cannot read pattern '%s'\n", rank, cfg->pattern);
+      FreeWorld(&source);
+      if (westFd >= 0) close(westFd);
+      if (eastFd >= 0) close(eastFd);
+      return 1;
+    }
+    int maxX = 0;
+    origin = INT32_MAX;
+    for (uint32_t i = 0; i < source.count; i++) {
+      if (source.nodes[i]->x < origin) origin = source.nodes[i]->x;
+      if (source.nodes[i]->x > maxX || i == 0) maxX = source.nodes[i]->x;
+    }
+    if (!source.count) origin = 0;
+    width = source.count ? maxX - origin + 1 : 1;
+  }
+  int strip = cfg->strip ? cfg->strip : (width + cfg->ranks - 1) / cfg->ranks;
+  if (strip < 1) strip = 1;
+
+  World world;
+  HaloExchange halo;
+  InitWorld(&world, 1024);
+  world.scheduler = cfg->threads == 1 ? NULL : CreateScheduler(cfg->threads);
+  InitHaloExchange(&halo, rank, cfg->ranks, origin, strip, westFd, eastFd);
+  world.halo = &halo;
+  if (cfg->pattern) CopyStrip(&world, &source);
+  else SeedStrip(&world, cfg->size, cfg->seed);
+  FreeWorld(&source);
+
+  // Only StepWorld is timed, exchange included; the checkpoint sums are not.
+  double stepSeconds = 0;
+  bool ok = Checkpoint(&world);
+  for (int gen = 1; ok && gen <= cfg->generations; gen++) {
+    double t = NowSeconds();
+    StepWorld(&world);
+    stepSeconds += NowSeconds() - t;
+    ok = !halo.failed;
+    if (ok && (gen % cfg->every == 0 || gen == cfg->generations)) ok = Checkpoint(&world);
+  }
+
+  uint64_t sums[SUMMARY_SUMS];
+  GetCheckpointSums(&world, sums);
+  sums[SUM_MESSAGES] = halo.stats.messages;
+  sums[SUM_EDGE_CHUNKS] = halo.stats.chunksSent;
+  sums[SUM_BYTES] = halo.stats.bytesSent;
+  sums[SUM_WAIT_MICROSECONDS] = (uint64_t)(halo.stats.waitSeconds * 1e6);
+  ok = ok && ReduceHalo(&halo, world.generation, sums, SUMMARY_SUMS);
+  int status = 0;
+  if (!ok) {
+    fprintf(stderr, "rank %d: lost its peers at generation %llu\n", rank, (unsigned long long)world.generation);
+    status = 1;
+  } else if (rank == 0) {
+    char rule[RULE_TEXT_MAX];
+    FormatRule(GetStepRule(), rule);
+    printf("{\"source\":\"%s\",\"seed\":%llu,\"size\":%d,\"rule\":\"%s\",\"kernel\":\"%s\",\"threads\":%d,"
+           "\"ranks\":%d,\"transport\":\"%s\",\"strip\":%d,\"generations\":%d,\"hash\":\"0x%016llx\","
+           "\"step_seconds\":%.6f,\"wall_seconds\":%.6f,\"gens_per_sec\":%.1f,\"halo_messages\":%llu,"
+           "\"halo_chunks\":%llu,\"halo_bytes\":%llu,\"halo_wait_seconds\":%.6f}\n",
+           cfg->pattern ? cfg->pattern : "random", (unsigned long long)cfg->seed, cfg->size, rule,
+           GetStepKernelName(GetStepKernel()), GetSchedulerThreadCount(world.scheduler), cfg->ranks, transport,
+           strip, cfg->generations, (unsigned long long)sums[SUM_HASH], stepSeconds, NowSeconds() - wallStart,
+           stepSeconds > 0 ? cfg->generations / stepSeconds : 0.0, (unsigned long long)sums[SUM_MESSAGES],
+           (unsigned long long)sums[SUM_EDGE_CHUNKS], (unsigned long long)sums[SUM_BYTES],
+           sums[SUM_WAIT_MICROSECONDS] * 1e-6);
+    if (cfg->hasExpected && sums[SUM_HASH] != cfg->expected) {
+      fprintf(stderr, "hash 0x%016llx does not match the expected 0x%016llx\n", (unsigned long long)sums[SUM_HASH],
+              (unsigned long long)cfg->expected);
+      status = 1;
+    }
+  }
+  world.halo = NULL;
+  DestroyScheduler(world.scheduler);
+  FreeWorld(&world);
+  FreeHaloExchange(&halo);
+  return status;
+}
+
+// Socket pair i joins rank i (its end 0, east) to rank i + 1 (its end 1, west).
+static int RunLocal(const ClusterConfig *cfg) {
+  int links = cfg->ranks - 1;
+  int (*pairs)[2] = malloc((links > 0 ? links : 1) * sizeof(*pairs));
+  for (int i = 0; i < links; i++) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i]) < 0) {
+      perror("socketpair");
+      return 1;
+    }
+  }
+  fflush(stdout);
+  pid_t *children = malloc(cfg->ranks * sizeof(pid_t));
+  for (int rank = 1; rank < cfg->ranks; rank++) {
+    children[rank] = fork();
+    if (children[rank] < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (children[rank] == 0) {
+      for (int i = 0; i < links; i++) {
+        if (i != rank - 1) close(pairs[i][1]);
+        if (i != rank) close(pairs[i][0]);
+      }
+      int west = pairs[rank - 1][1], east = rank < links ? pairs[rank][0] : -1;
+      free(pairs);
+      free(children);
+      exit(RunRank(cfg, rank, west, east, "unix"));
+    }
+  }
+  for (int i = 0; i < links; i++) {
+    close(pairs[i][1]);
+    if (i) close(pairs[i][0]);
+  }
+  int status = RunRank(cfg, 0, -1, links ? pairs[0][0] : -1, "unix");
+  for (int rank = 1; rank < cfg->ranks; rank++) {
+    int childStatus;
+    if (waitpid(children[rank], &childStatus, 0) < 0 || !WIFEXITED(childStatus) || WEXITSTATUS(childStatus))
+      status = 1;
+  }
+  free(pairs);
+  free(children);
+  return status;
+}
+
+static void SetNoDelay(int fd) {
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+static int ListenTcp(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port), .sin_addr.s_addr = INADDR_ANY };
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// The peer may not be listening yet, so keep trying for a while.
+static int ConnectTcp(const char *host, int port) {
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *addresses;
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) return -1;
+  int fd = -1;
+  double deadline = NowSeconds() + CLUSTER_CONNECT_SECONDS;
+  while (fd < 0 && NowSeconds() < deadline) {
+    for (struct addrinfo *a = addresses; a && fd < 0; a = a->ai_next) {
+      fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (fd < 0) usleep(100 * 1000);
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+// hosts is a comma-separated list by rank; missing entries are 127.0.0.1.
+static void GetHost(const char *hosts, int rank, char *host, size_t size) {
+  snprintf(host, size, "127.0.0.1");
+  for (int i = 0; hosts && *hosts; i++) {
+    const char *end = strchr(hosts, ',');
+    size_t length = end ? (size_t)(end - hosts) : strlen(hosts);
+    if (i == rank && length) {
+      snprintf(host, size, "%.*s", (int)length, hosts);
+      return;
+    }
+    hosts = end ? end + 1 : hosts + length;
+  }
+}
+
+static int RunTcp(const ClusterConfig *cfg) {
+  int rank = cfg->rank, west = -1, east = -1, listener = -1;
+  // Listen before connecting, so the east neighbour can connect while this rank waits on its west one.
+  if (rank < cfg->ranks - 1 && (listener = ListenTcp(cfg->port + rank)) < 0) {
+    fprintf(stderr, "rank %d: cannot listen on port %d: %s\n", rank, cfg->port + rank, strerror(errno));
+    return 1;
+  }
+  if (rank > 0) {
+    char host[256];
+    GetHost(cfg->hosts, rank - 1, host, sizeof(host));
+    if ((west = ConnectTcp(host, cfg->port + rank - 1)) < 0) {
+      fprintf(stderr, "rank %d: cannot connect to rank %d at %s:%d\n", rank, rank - 1, host, cfg->port + rank - 1);
+      if (listener >= 0) close(listener);
+      return 1;
+    }
+    SetNoDelay(west);
+  }
+  if (listener >= 0) {
+    east = accept(listener, NULL, NULL);
+    close(listener);
+    if (east < 0) {
+      fprintf(stderr, "rank %d: accept failed: %s\n", rank, strerror(errno));
+      if (west >= 0) close(west);
+      return 1;
+    }
+    SetNoDelay(east);
+  }
+  return RunRank(cfg, rank, west, east, "tcp");
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [--ranks N] [--strip W] [--seed S] [--size N] [--pattern file.rle|file.mc] [--rule B3/S23]\n"
+                  "          [--gens N] [--every N] [--threads N] [--kernel scalar|avx2|avx512] [--expect HASH]\n"
+                  "          [--rank R --port P [--hosts host0,host1,...]]\n", name);
+}
+
+int main(int argc, char **argv) {
+  ClusterConfig cfg = { .seed = 1, .size = 256, .generations = 1000, .every = 100, .threads = 1, .ranks = 2,
+                        .rank = -1 };
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--ranks") == 0 && value) {
+      cfg.ranks = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--strip") == 0 && value) {
+      cfg.strip = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      cfg.seed = strtoull(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      cfg.size = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--pattern") == 0 && value) {
+      cfg.pattern = value;
+      i++;
+    } else if (strcmp(arg, "--gens") == 0 && value) {
+      cfg.generations = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--every") == 0 && value) {
+      cfg.every = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      cfg.threads = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--kernel") == 0 && value) {
+      int k = 0;
+      while (k < STEP_KERNEL_COUNT && strcmp(value, GetStepKernelName((StepKernel)k)) != 0) k++;
+      if (!SetStepKernel((StepKernel)k)) {
+        fprintf(stderr, "step kernel '%s' is not supported on this CPU\n", value);
+        return 1;
+      }
+      i++;
+    } else if (strcmp(arg, "--rule") == 0 && value) {
+      Rule rule;
+      if (!ParseRule(value, &rule)) {
+        fprintf(stderr, "invalid rule '%s' (B0 rules are not supported)\n", value);
+        return 1;
+      }
+      SetStepRule(rule);
+      cfg.ruleGiven = true;
+      i++;
+    } else if (strcmp(arg, "--expect") == 0 && value) {
+      cfg.expected = strtoull(value, NULL, 16);
+      cfg.hasExpected = true;
+      i++;
+    } else if (strcmp(arg, "--rank") == 0 && value) {
+      cfg.rank = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--port") == 0 && value) {
+      cfg.port = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--hosts") == 0 && value) {
+      cfg.hosts = value;
+      i++;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (cfg.generations < 0 || cfg.every <= 0 || cfg.size <= 0 || cfg.ranks <= 0 || cfg.strip < 0 ||
+      cfg.rank >= cfg.ranks || (cfg.rank >= 0 && cfg.port <= 0)) {
+    Usage(argv[0]);
+    return 1;
+  }
+  return cfg.rank < 0 ? RunLocal(&cfg) : RunTcp(&cfg);
+}
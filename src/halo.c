@@ -0,0 +1,279 @@
+#include "halo.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum {
+  HALO_EDGE, // Edge chunks that may have changed, as HaloEdgeChunk records
+  HALO_SUM   // Partial sums for ReduceHalo, as uint64_t records
+} HaloMessageKind;
+
+typedef struct HaloHeader {
+  uint32_t kind;
+  uint32_t count;
+  uint64_t generation;
+} HaloHeader;
+
+typedef struct HaloEdgeChunk {
+  int32_t y;
+  uint32_t reserved;
+  uint64_t value;
+} HaloEdgeChunk;
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void InitHaloExchange(HaloExchange *h, int rank, int ranks, int origin, int width, int westFd, int eastFd) {
+  *h = (HaloExchange){
+    .rank = rank,
+    .ranks = ranks,
+    .x0 = rank ? origin + rank * width : INT_MIN,
+    .x1 = rank < ranks - 1 ? origin + (rank + 1) * width : INT_MAX,
+  };
+  h->links[HALO_WEST].fd = westFd;
+  h->links[HALO_EAST].fd = eastFd;
+}
+
+void FreeHaloExchange(HaloExchange *h) {
+  for (int side = 0; side < 2; side++) {
+    if (h->links[side].fd >= 0) close(h->links[side].fd);
+    free(h->links[side].out);
+    free(h->links[side].in);
+  }
+  free(h->edges);
+  *h = (HaloExchange){ 0 };
+}
+
+static void Reserve(uint8_t **data, size_t *capacity, size_t size) {
+  if (size <= *capacity) return;
+  while (*capacity < size) *capacity = *capacity ? *capacity * 2 : 4096;
+  *data = realloc(*data, *capacity);
+}
+
+static void AppendOut(HaloExchange *h, HaloLink *l, const void *data, size_t size) {
+  Reserve(&l->out, &l->outCapacity, l->outLength + size);
+  memcpy(l->out + l->outLength, data, size);
+  l->outLength += size;
+  h->stats.bytesSent += size;
+}
+
+// Hands the kernel as much of the output as it takes without blocking.
+static bool SendPending(HaloLink *l) {
+  while (l->outSent < l->outLength) {
+    ssize_t n = send(l->fd, l->out + l->outSent, l->outLength - l->outSent, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    l->outSent += (size_t)n;
+  }
+  l->outLength = l->outSent = 0;
+  return true;
+}
+
+static bool ReceivePending(HaloLink *l) {
+  for (;;) {
+    Reserve(&l->in, &l->inCapacity, l->inLength + 65536);
+    ssize_t n = recv(l->fd, l->in + l->inLength, l->inCapacity - l->inLength, MSG_DONTWAIT);
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    l->inLength += (size_t)n;
+  }
+}
+
+static size_t RecordSize(uint32_t kind) {
+  return kind == HALO_EDGE ? sizeof(HaloEdgeChunk) : sizeof(uint64_t);
+}
+
+// Length of the complete message at the start of the input, or 0.
+static size_t MessageLength(const HaloLink *l) {
+  if (l->inLength < sizeof(HaloHeader)) return 0;
+  HaloHeader header;
+  memcpy(&header, l->in, sizeof(header));
+  size_t length = sizeof(HaloHeader) + (size_t)header.count * RecordSize(header.kind);
+  return l->inLength >= length ? length : 0;
+}
+
+static void DropMessage(HaloLink *l, size_t length) {
+  memmove(l->in, l->in + length, l->inLength - length);
+  l->inLength -= length;
+}
+
+// Sends every link's output, and waits until each link in `need` holds a complete message. The
+// peers may already be a message ahead, so input is kept past the first message.
+static bool PumpLinks(HaloExchange *h, const bool need[2]) {
+  for (;;) {
+    struct pollfd fds[2];
+    HaloLink *links[2];
+    int count = 0;
+    for (int side = 0; side < 2; side++) {
+      HaloLink *l = &h->links[side];
+      if (l->fd < 0) continue;
+      short events = 0;
+      if (l->outSent < l->outLength) events |= POLLOUT;
+      if (need[side] && !MessageLength(l)) events |= POLLIN;
+      if (!events) continue;
+      fds[count] = (struct pollfd){ l->fd, events, 0 };
+      links[count++] = l;
+    }
+    if (!count) return true;
+    if (poll(fds, (nfds_t)count, -1) < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    for (int i = 0; i < count; i++) {
+      if ((fds[i].revents & POLLOUT) && !SendPending(links[i])) return false;
+      // A peer that is done may close right behind its last message.
+      bool open = !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) || ReceivePending(links[i]);
+      if (!open && !MessageLength(links[i])) return false;
+    }
+  }
+}
+
+static bool Fail(HaloExchange *h) {
+  h->failed = true;
+  return false;
+}
+
+static void PostEdge(HaloExchange *h, int side, const ChunkNode **nodes, uint32_t count, uint64_t generation) {
+  HaloLink *l = &h->links[side];
+  if (l->fd < 0) return;
+  HaloHeader header = { HALO_EDGE, count, generation };
+  AppendOut(h, l, &header, sizeof(header));
+  for (uint32_t i = 0; i < count; i++) {
+    HaloEdgeChunk chunk = { nodes[i]->y, 0, nodes[i]->c.chunk_value };
+    AppendOut(h, l, &chunk, sizeof(chunk));
+  }
+  h->stats.messages++;
+  h->stats.chunksSent += count;
+  if (!SendPending(l)) Fail(h);
+}
+
+uint32_t BeginHaloExchange(World *w) {
+  HaloExchange *h = w->halo;
+  uint32_t needed = w->active.count + w->blinking.count;
+  if (needed * 2 > h->edgeCapacity) {
+    h->edgeCapacity = needed * 4;
+    h->edges = realloc(h->edges, h->edgeCapacity * sizeof(ChunkNode *));
+  }
+
+  // A chunk's value only changes when it is stepped or blinks, and a changed chunk is stepped in the
+  // next generation. So the active and blinking edge chunks cover every change since the last post.
+  const ChunkNode **west = (const ChunkNode **)h->edges, **east = west + needed;
+  uint32_t westCount = 0, eastCount = 0;
+  for (int list = 0; list < 2; list++) {
+    const NodeList *nodes = list ? &w->blinking : &w->active;
+    for (uint32_t i = 0; i < nodes->count; i++) {
+      const ChunkNode *node = nodes->items[i];
+      if (list && node->state != CHUNK_BLINKING) continue;
+      if (node->x == h->x0) west[westCount++] = node;
+      if (node->x == h->x1 - 1) east[eastCount++] = node;
+    }
+  }
+  PostEdge(h, HALO_WEST, west, westCount, w->generation);
+  PostEdge(h, HALO_EAST, east, eastCount, w->generation);
+
+  // Ghosts were queued by their neighbours; interior chunks stay in place, edge chunks go last.
+  uint32_t kept = 0, edgeCount = 0;
+  ChunkNode **edges = h->edges;
+  for (uint32_t i = 0; i < w->active.count; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (!IsHaloColumnOwned(h, node->x)) {
+      node->state = CHUNK_ASLEEP;
+      node->activeStamp = 0;
+      node->changed = false;
+    } else if (node->x == h->x0 || node->x == h->x1 - 1) {
+      edges[edgeCount++] = node;
+    } else {
+      w->active.items[kept++] = node;
+    }
+  }
+  memcpy(w->active.items + kept, edges, edgeCount * sizeof(ChunkNode *));
+  w->active.count = kept + edgeCount;
+  return kept;
+}
+
+static void WriteGhosts(World *w, const HaloEdgeChunk *chunks, uint32_t count, int x) {
+  HaloExchange *h = w->halo;
+  for (uint32_t i = 0; i < count; i++) {
+    SetChunkValue(w, x, chunks[i].y, chunks[i].value);
+    // Births across the strip's edge need the owned chunks to exist, as StepWorld's growth pass
+    // does for chunks it steps.
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      int nx = x + NEIGHBOUR_DX[n];
+      if (IsHaloColumnOwned(h, nx) && (chunks[i].value & NEIGHBOUR_EDGE[n]))
+        GetOrCreateChunk(w, nx, chunks[i].y + NEIGHBOUR_DY[n]);
+    }
+  }
+}
+
+void FinishHaloExchange(World *w, uint32_t interior) {
+  HaloExchange *h = w->halo;
+  bool need[2] = { h->links[HALO_WEST].fd >= 0, h->links[HALO_EAST].fd >= 0 };
+  double start = NowSeconds();
+  if (!h->failed && !PumpLinks(h, need)) Fail(h);
+  h->stats.waitSeconds += NowSeconds() - start;
+  if (h->failed) return;
+
+  for (int side = 0; side < 2; side++) {
+    HaloLink *l = &h->links[side];
+    if (!need[side]) continue;
+    HaloHeader header;
+    memcpy(&header, l->in, sizeof(header));
+    if (header.kind != HALO_EDGE || header.generation != w->generation) {
+      Fail(h);
+      return;
+    }
+    WriteGhosts(w, (const HaloEdgeChunk *)(l->in + sizeof(header)), header.count,
+                side == HALO_WEST ? h->x0 - 1 : h->x1);
+    DropMessage(l, MessageLength(l));
+  }
+
+  // Writing the ghosts queued them again, along with the owned chunks they touch.
+  uint32_t kept = interior;
+  for (uint32_t i = interior; i < w->active.count; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (IsHaloColumnOwned(h, node->x)) {
+      w->active.items[kept++] = node;
+      continue;
+    }
+    node->state = CHUNK_ASLEEP;
+    node->activeStamp = 0;
+    node->changed = false;
+  }
+  w->active.count = kept;
+}
+
+bool ReduceHalo(HaloExchange *h, uint64_t generation, uint64_t *values, uint32_t count) {
+  if (h->failed) return false;
+  HaloLink *east = &h->links[HALO_EAST], *west = &h->links[HALO_WEST];
+  if (east->fd >= 0) {
+    bool need[2] = { false, true };
+    if (!PumpLinks(h, need)) return Fail(h);
+    HaloHeader header;
+    memcpy(&header, east->in, sizeof(header));
+    if (header.kind != HALO_SUM || header.count != count || header.generation != generation) return Fail(h);
+    const uint8_t *sums = east->in + sizeof(header);
+    for (uint32_t i = 0; i < count; i++) {
+      uint64_t sum;
+      memcpy(&sum, sums + i * sizeof(uint64_t), sizeof(sum));
+      values[i] += sum;
+    }
+    DropMessage(east, MessageLength(east));
+  }
+  if (west->fd >= 0) {
+    HaloHeader header = { HALO_SUM, count, generation };
+    AppendOut(h, west, &header, sizeof(header));
+    AppendOut(h, west, values, count * sizeof(uint64_t));
+    h->stats.messages++;
+    bool need[2] = { false, false };
+    if (!PumpLinks(h, need)) return Fail(h);
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef HALO_H
+#define HALO_H
+
+#include "world.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One world stepped by several processes ("ranks"), for worlds larger than one machine's memory.
+// The plane is cut into vertical strips of chunk columns: rank r of n owns the columns
+// [origin + r * width, origin + (r + 1) * width), the first and last strips reaching to infinity.
+// Each rank's World holds its strip plus a ghost column just outside each side, a copy of the
+// neighbouring rank's edge column. Ranks talk to their west and east neighbours over any stream
+// socket, Unix or TCP.
+//
+// A World with a HaloExchange attached (World.halo) does the exchange inside StepWorld. It posts
+// its edge chunks that may have changed since the last generation (one uint64_t per chunk, tagged
+// with its row), steps the interior chunks while those are in flight, then writes the peers' edges
+// into the ghost columns and steps its own edge chunks. Ghost chunks are never stepped.
+//
+// Messages are in host byte order, so every rank must share one.
+#define HALO_WEST 0
+#define HALO_EAST 1
+
+typedef struct HaloLink {
+  int fd; // -1 without a peer on this side
+  uint8_t *out;
+  size_t outLength, outSent, outCapacity;
+  uint8_t *in;
+  size_t inLength, inCapacity;
+} HaloLink;
+
+typedef struct HaloStats {
+  uint64_t messages; // Sent, sums included
+  uint64_t chunksSent; // Edge chunks sent
+  uint64_t bytesSent;
+  double waitSeconds; // Blocked on peers once the interior was stepped
+} HaloStats;
+
+typedef struct HaloExchange {
+  int rank, ranks;
+  int x0, x1; // Owned chunk columns [x0, x1); INT_MIN and INT_MAX at the open ends
+  HaloLink links[2]; // By HALO_WEST and HALO_EAST
+  ChunkNode **edges; // Step scratch: edge chunks, stepped after the interior
+  uint32_t edgeCapacity;
+  bool failed; // A peer closed its socket or sent something unexpected; the world is now wrong
+  HaloStats stats;
+} HaloExchange;
+
+// Takes ownership of the connected socket to each neighbour, -1 where there is none (rank 0 has
+// no west neighbour and rank ranks - 1 no east one).
+void InitHaloExchange(HaloExchange *h, int rank, int ranks, int origin, int width, int westFd, int eastFd);
+// Closes the sockets. Detach it from its world (or free the world) first.
+void FreeHaloExchange(HaloExchange *h);
+
+static inline bool IsHaloColumnOwned(const HaloExchange *h, int x) {
+  return x >= h->x0 && x < h->x1;
+}
+
+// Called by StepWorld after it made room for births: posts the edges, takes the ghost chunks off
+// the active list and moves the edge chunks to its end. Returns the number of interior chunks,
+// which come first.
+uint32_t BeginHaloExchange(World *w);
+// Called by StepWorld once the interior is stepped: waits for both peers' edges and writes them
+// into the ghost columns. Owned chunks woken by them join the edge chunks at the end of the list.
+void FinishHaloExchange(World *w, uint32_t interior);
+
+// Adds up count values over every rank, between steps, on every rank. Rank 0 ends up with the
+// totals; the others with the sums over themselves and the ranks east of them.
+bool ReduceHalo(HaloExchange *h, uint64_t generation, uint64_t *values, uint32_t count);
+
+#endif
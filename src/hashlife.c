@@ -0,0 +1,411 @@
+#include "hashlife.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Nodes are always created after their children, so a child id is lower than its parent's.
+// Garbage collection relies on that to compact the store in one forward pass.
+
+#define NODE(hl, id) ((hl)->nodes[id])
+
+static uint32_t MixHash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+static uint32_t HashLeaf(uint64_t bits) {
+  return MixHash(bits ^ 0x5851f42d4c957f2dULL);
+}
+
+static uint32_t HashQuad(NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+  uint64_t a = ((uint64_t)nw << 32) | ne;
+  uint64_t b = ((uint64_t)sw << 32) | se;
+  return MixHash(a * 0x9e3779b97f4a7c15ULL ^ MixHash(b));
+}
+
+static void InsertNodeId(HashLife *hl, NodeId id) {
+  uint32_t mask = hl->tableCapacity - 1;
+  uint32_t i = NODE(hl, id).hash & mask;
+  while (hl->table[i]) i = (i + 1) & mask;
+  hl->table[i] = id;
+}
+
+static void ResizeTable(HashLife *hl, uint32_t capacity) {
+  free(hl->table);
+  hl->table = calloc(capacity, sizeof(NodeId));
+  hl->tableCapacity = capacity;
+  for (NodeId id = 1; id < hl->count; id++) InsertNodeId(hl, id);
+}
+
+static NodeId AllocNode(HashLife *hl, QuadNode node) {
+  if (hl->count == hl->capacity) {
+    hl->capacity *= 2;
+    hl->nodes = realloc(hl->nodes, hl->capacity * sizeof(QuadNode));
+  }
+  NodeId id = hl->count++;
+  hl->nodes[id] = node;
+  if ((uint64_t)hl->count * 2 > hl->tableCapacity) ResizeTable(hl, hl->tableCapacity * 2);
+  else InsertNodeId(hl, id);
+  return id;
+}
+
+static NodeId Leaf(HashLife *hl, uint64_t bits) {
+  uint32_t hash = HashLeaf(bits);
+  uint32_t mask = hl->tableCapacity - 1;
+  for (uint32_t i = hash & mask; hl->table[i]; i = (i + 1) & mask) {
+    const QuadNode *n = &NODE(hl, hl->table[i]);
+    if (n->hash == hash && n->level == HASHLIFE_LEAF_LEVEL && n->leaf == bits) return hl->table[i];
+  }
+  return AllocNode(hl, (QuadNode){ .leaf = bits, .hash = hash, .level = HASHLIFE_LEAF_LEVEL });
+}
+
+static NodeId Join(HashLife *hl, NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+  uint32_t hash = HashQuad(nw, ne, sw, se);
+  uint32_t mask = hl->tableCapacity - 1;
+  for (uint32_t i = hash & mask; hl->table[i]; i = (i + 1) & mask) {
+    const QuadNode *n = &NODE(hl, hl->table[i]);
+    if (n->hash == hash && n->level > HASHLIFE_LEAF_LEVEL && n->quad.nw == nw && n->quad.ne == ne &&
+        n->quad.sw == sw && n->quad.se == se)
+      return hl->table[i];
+  }
+  uint8_t level = NODE(hl, nw).level + 1;
+  return AllocNode(hl, (QuadNode){ .quad = { nw, ne, sw, se }, .hash = hash, .level = level });
+}
+
+static NodeId Empty(HashLife *hl, int level) {
+  if (!hl->empty[level]) {
+    hl->empty[level] = level == HASHLIFE_LEAF_LEVEL ? Leaf(hl, 0) : Join(hl, Empty(hl, level - 1), Empty(hl, level - 1),
+                                                                         Empty(hl, level - 1), Empty(hl, level - 1));
+  }
+  return hl->empty[level];
+}
+
+void InitHashLife(HashLife *hl, size_t memoryLimit) {
+  *hl = (HashLife){
+    .capacity = 1024,
+    .nodes = malloc(1024 * sizeof(QuadNode)),
+    .count = 1, // Id 0 stays unused
+    .tableCapacity = 2048,
+    .table = calloc(2048, sizeof(NodeId)),
+    .memoryLimit = memoryLimit,
+  };
+  hl->root = Empty(hl, HASHLIFE_LEAF_LEVEL + 3);
+}
+
+void FreeHashLife(HashLife *hl) {
+  free(hl->nodes);
+  free(hl->table);
+  *hl = (HashLife){ 0 };
+}
+
+size_t GetHashLifeMemory(const HashLife *hl) {
+  return (size_t)hl->capacity * sizeof(QuadNode) + (size_t)hl->tableCapacity * sizeof(NodeId);
+}
+
+// The 8x8 centre of a 16x16 square given as four leaves.
+static uint64_t CentreBits(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se) {
+  const uint64_t M = 0x0F0F0F0FULL;
+  uint64_t top = ((nw >> 36) & M) | (((ne >> 32) & M) << 4);
+  uint64_t bottom = ((sw >> 4) & M) | ((se & M) << 4);
+  return top | (bottom << 32);
+}
+
+// Base case: a 16x16 square (level 4) stepped directly with the SWAR kernel. After s <= 4
+// generations the centre 8x8 is still exact, since outside cells can only reach 4 cells in.
+static uint64_t StepLevel4(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se, int steps) {
+  uint64_t g[2][2] = { { nw, ne }, { sw, se } };
+  for (int s = 0; s < steps; s++) {
+    uint64_t next[2][2];
+    for (int y = 0; y < 2; y++) {
+      for (int x = 0; x < 2; x++) {
+        uint64_t n[MAX_NEIGHBOURS];
+        for (int k = 0; k < MAX_NEIGHBOURS; k++) {
+          int nx = x + NEIGHBOUR_DX[k], ny = y + NEIGHBOUR_DY[k];
+          n[k] = (nx >= 0 && nx < 2 && ny >= 0 && ny < 2) ? g[ny][nx] : 0;
+        }
+        next[y][x] = StepChunk(g[y][x], n);
+      }
+    }
+    memcpy(g, next, sizeof(g));
+  }
+  return CentreBits(g[0][0], g[0][1], g[1][0], g[1][1]);
+}
+
+// Centre of a node one level down, without advancing time.
+static NodeId Centre(HashLife *hl, NodeId id) {
+  QuadNode n = NODE(hl, id);
+  if (n.level == HASHLIFE_LEAF_LEVEL + 1) {
+    return Leaf(hl, CentreBits(NODE(hl, n.quad.nw).leaf, NODE(hl, n.quad.ne).leaf, NODE(hl, n.quad.sw).leaf,
+                               NODE(hl, n.quad.se).leaf));
+  }
+  return Join(hl, NODE(hl, n.quad.nw).quad.se, NODE(hl, n.quad.ne).quad.sw, NODE(hl, n.quad.sw).quad.ne,
+              NODE(hl, n.quad.se).quad.nw);
+}
+
+// The node straddling two horizontally or vertically adjacent nodes of the same level.
+static NodeId CentreHorizontal(HashLife *hl, NodeId w, NodeId e) {
+  QuadNode a = NODE(hl, w), b = NODE(hl, e);
+  return Join(hl, a.quad.ne, b.quad.nw, a.quad.se, b.quad.sw);
+}
+
+static NodeId CentreVertical(HashLife *hl, NodeId n, NodeId s) {
+  QuadNode a = NODE(hl, n), b = NODE(hl, s);
+  return Join(hl, a.quad.sw, a.quad.se, b.quad.nw, b.quad.ne);
+}
+
+// RESULT: the centre of a level-n node advanced min(2^stepLog2, 2^(n-2)) generations.
+static NodeId Result(HashLife *hl, NodeId id) {
+  if (NODE(hl, id).result) return NODE(hl, id).result;
+
+  QuadNode n = NODE(hl, id);
+  NodeId result;
+  if (n.level == HASHLIFE_LEAF_LEVEL + 1) {
+    int steps = 1 << (hl->stepLog2 < 2 ? hl->stepLog2 : 2);
+    result = Leaf(hl, StepLevel4(NODE(hl, n.quad.nw).leaf, NODE(hl, n.quad.ne).leaf, NODE(hl, n.quad.sw).leaf,
+                                 NODE(hl, n.quad.se).leaf, steps));
+  } else {
+    // Nine overlapping sub-squares one level down...
+    NodeId parts[3][3] = {
+      { n.quad.nw, CentreHorizontal(hl, n.quad.nw, n.quad.ne), n.quad.ne },
+      { CentreVertical(hl, n.quad.nw, n.quad.sw), Centre(hl, id), CentreVertical(hl, n.quad.ne, n.quad.se) },
+      { n.quad.sw, CentreHorizontal(hl, n.quad.sw, n.quad.se), n.quad.se },
+    };
+    // ...each either advanced half the way (full speed) or just cropped (slower steps)...
+    bool fullSpeed = hl->stepLog2 >= n.level - 2;
+    for (int y = 0; y < 3; y++)
+      for (int x = 0; x < 3; x++)
+        parts[y][x] = fullSpeed ? Result(hl, parts[y][x]) : Centre(hl, parts[y][x]);
+    // ...then regrouped into four and advanced the rest of the way.
+    NodeId nw = Result(hl, Join(hl, parts[0][0], parts[0][1], parts[1][0], parts[1][1]));
+    NodeId ne = Result(hl, Join(hl, parts[0][1], parts[0][2], parts[1][1], parts[1][2]));
+    NodeId sw = Result(hl, Join(hl, parts[1][0], parts[1][1], parts[2][0], parts[2][1]));
+    NodeId se = Result(hl, Join(hl, parts[1][1], parts[1][2], parts[2][1], parts[2][2]));
+    result = Join(hl, nw, ne, sw, se);
+  }
+  NODE(hl, id).result = result;
+  return result;
+}
+
+// Same pattern one level up, centred in an empty border.
+static NodeId Expand(HashLife *hl, NodeId id) {
+  QuadNode n = NODE(hl, id);
+  if (n.level == HASHLIFE_LEAF_LEVEL) return id;
+  NodeId e = Empty(hl, n.level - 1);
+  return Join(hl, Join(hl, e, e, e, n.quad.nw), Join(hl, e, e, n.quad.ne, e), Join(hl, e, n.quad.sw, e, e),
+              Join(hl, n.quad.se, e, e, e));
+}
+
+static void GrowRoot(HashLife *hl) {
+  int64_t quarter = (int64_t)1 << (NODE(hl, hl->root).level - 1);
+  hl->root = Expand(hl, hl->root);
+  hl->originX -= quarter;
+  hl->originY -= quarter;
+}
+
+// True when every live cell lies in the middle quarter (by width) of the root, so the pattern can
+// grow by an eighth of the root's width on each side and still land in RESULT.
+static bool IsRootPadded(HashLife *hl) {
+  QuadNode r = NODE(hl, hl->root);
+  if (r.level < HASHLIFE_LEAF_LEVEL + 3) return false;
+  NodeId inner = Join(hl, NODE(hl, NODE(hl, r.quad.nw).quad.se).quad.se, NODE(hl, NODE(hl, r.quad.ne).quad.sw).quad.sw,
+                      NODE(hl, NODE(hl, r.quad.sw).quad.ne).quad.ne, NODE(hl, NODE(hl, r.quad.se).quad.nw).quad.nw);
+  return Expand(hl, Expand(hl, inner)) == hl->root;
+}
+
+// Strips empty borders so later steps do not recurse through a needlessly large tree.
+static void ShrinkRoot(HashLife *hl) {
+  while (NODE(hl, hl->root).level > HASHLIFE_LEAF_LEVEL + 3) {
+    NodeId centre = Centre(hl, hl->root);
+    if (Expand(hl, centre) != hl->root) break;
+    int64_t quarter = (int64_t)1 << (NODE(hl, hl->root).level - 2);
+    hl->root = centre;
+    hl->originX += quarter;
+    hl->originY += quarter;
+  }
+}
+
+// A level-n result covers 2^min(stepLog2, n - 2) generations, so results of levels that run at
+// full speed under both the old and the new step stay valid.
+static void SetStepLog2(HashLife *hl, int k) {
+  if (hl->stepLog2 == k) return;
+  int keep = (hl->stepLog2 < k ? hl->stepLog2 : k) + 2;
+  hl->stepLog2 = k;
+  for (NodeId id = 1; id < hl->count; id++) {
+    if (hl->nodes[id].level > keep) hl->nodes[id].result = 0;
+  }
+}
+
+void JumpHashLife(HashLife *hl, int k) {
+  if (k < 0) return;
+  if (hl->memoryLimit && GetHashLifeMemory(hl) > hl->memoryLimit) CollectHashLifeGarbage(hl);
+  SetStepLog2(hl, k);
+
+  while (NODE(hl, hl->root).level < k + 3 || !IsRootPadded(hl)) {
+    if (NODE(hl, hl->root).level >= HASHLIFE_MAX_LEVEL) return;
+    GrowRoot(hl);
+  }
+
+  int64_t quarter = (int64_t)1 << (NODE(hl, hl->root).level - 2);
+  hl->root = Result(hl, hl->root);
+  hl->originX += quarter;
+  hl->originY += quarter;
+  hl->generation += (uint64_t)1 << k;
+  ShrinkRoot(hl);
+}
+
+static void MarkNode(HashLife *hl, NodeId id) {
+  if (hl->nodes[id].mark) return;
+  hl->nodes[id].mark = 1;
+  if (hl->nodes[id].level > HASHLIFE_LEAF_LEVEL) {
+    QuadNode n = hl->nodes[id];
+    MarkNode(hl, n.quad.nw);
+    MarkNode(hl, n.quad.ne);
+    MarkNode(hl, n.quad.sw);
+    MarkNode(hl, n.quad.se);
+  }
+}
+
+void CollectHashLifeGarbage(HashLife *hl) {
+  MarkNode(hl, hl->root);
+
+  NodeId *remap = calloc(hl->count, sizeof(NodeId));
+  uint32_t kept = 1;
+  for (NodeId id = 1; id < hl->count; id++) {
+    QuadNode n = hl->nodes[id];
+    if (!n.mark) continue;
+    n.mark = 0;
+    n.result = 0;
+    if (n.level > HASHLIFE_LEAF_LEVEL) {
+      n.quad.nw = remap[n.quad.nw];
+      n.quad.ne = remap[n.quad.ne];
+      n.quad.sw = remap[n.quad.sw];
+      n.quad.se = remap[n.quad.se];
+      n.hash = HashQuad(n.quad.nw, n.quad.ne, n.quad.sw, n.quad.se);
+    }
+    remap[id] = kept;
+    hl->nodes[kept++] = n;
+  }
+  hl->root = remap[hl->root];
+  free(remap);
+
+  hl->count = kept;
+  uint32_t capacity = 1024;
+  while (capacity < kept * 2) capacity *= 2;
+  hl->capacity = capacity;
+  hl->nodes = realloc(hl->nodes, capacity * sizeof(QuadNode));
+  ResizeTable(hl, capacity * 2);
+  memset(hl->empty, 0, sizeof(hl->empty));
+  hl->gcCount++;
+}
+
+typedef struct LeafEntry {
+  int64_t x, y; // Chunk coordinates relative to the root origin
+  uint64_t value;
+} LeafEntry;
+
+static NodeId BuildNode(HashLife *hl, LeafEntry *entries, size_t count, int64_t x0, int64_t y0, int level) {
+  if (count == 0) return Empty(hl, level);
+  if (level == HASHLIFE_LEAF_LEVEL) return Leaf(hl, entries[0].value);
+
+  // Partition in place: west before east, then north before south within each half.
+  int64_t half = (int64_t)1 << (level - HASHLIFE_LEAF_LEVEL - 1);
+  size_t split = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].x < x0 + half) {
+      LeafEntry t = entries[i];
+      entries[i] = entries[split];
+      entries[split++] = t;
+    }
+  }
+  size_t bounds[5] = { 0, 0, split, split, count };
+  for (int side = 0; side < 2; side++) {
+    size_t begin = bounds[side * 2], end = bounds[side * 2 + 2], mid = begin;
+    for (size_t i = begin; i < end; i++) {
+      if (entries[i].y < y0 + half) {
+        LeafEntry t = entries[i];
+        entries[i] = entries[mid];
+        entries[mid++] = t;
+      }
+    }
+    bounds[side * 2 + 1] = mid;
+  }
+
+  NodeId nw = BuildNode(hl, entries + bounds[0], bounds[1] - bounds[0], x0, y0, level - 1);
+  NodeId sw = BuildNode(hl, entries + bounds[1], bounds[2] - bounds[1], x0, y0 + half, level - 1);
+  NodeId ne = BuildNode(hl, entries + bounds[2], bounds[3] - bounds[2], x0 + half, y0, level - 1);
+  NodeId se = BuildNode(hl, entries + bounds[3], bounds[4] - bounds[3], x0 + half, y0 + half, level - 1);
+  return Join(hl, nw, ne, sw, se);
+}
+
+static void LoadPattern(HashLife *hl, const World *w, bool centred) {
+  LeafEntry *entries = malloc((w->count ? w->count : 1) * sizeof(LeafEntry));
+  size_t count = 0;
+  int minX = 0, minY = 0, maxX = 0, maxY = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!node->c.chunk_value) continue;
+    if (count == 0 || node->x < minX) minX = node->x;
+    if (count == 0 || node->y < minY) minY = node->y;
+    if (count == 0 || node->x > maxX) maxX = node->x;
+    if (count == 0 || node->y > maxY) maxY = node->y;
+    entries[count++] = (LeafEntry){ node->x, node->y, node->c.chunk_value };
+  }
+
+  int level = HASHLIFE_LEAF_LEVEL + 3;
+  int64_t originX = minX, originY = minY; // In chunks
+  if (centred) {
+    // The root spans [-half, half) chunks on both axes.
+    int64_t half = (int64_t)1 << (level - HASHLIFE_LEAF_LEVEL - 1);
+    while (minX < -half || minY < -half || maxX >= half || maxY >= half) {
+      level++;
+      half <<= 1;
+    }
+    originX = originY = -half;
+  } else {
+    while (((int64_t)1 << (level - HASHLIFE_LEAF_LEVEL)) <= (int64_t)maxX - minX ||
+           ((int64_t)1 << (level - HASHLIFE_LEAF_LEVEL)) <= (int64_t)maxY - minY)
+      level++;
+  }
+  for (size_t i = 0; i < count; i++) {
+    entries[i].x -= originX;
+    entries[i].y -= originY;
+  }
+
+  hl->root = BuildNode(hl, entries, count, 0, 0, level);
+  hl->originX = originX * CHUNK_SIZE;
+  hl->originY = originY * CHUNK_SIZE;
+  hl->generation = w->generation;
+  free(entries);
+}
+
+void LoadHashLifeFromWorld(HashLife *hl, const World *w) {
+  LoadPattern(hl, w, false);
+}
+
+void LoadHashLifeCentred(HashLife *hl, const World *w) {
+  LoadPattern(hl, w, true);
+}
+
+static void StoreNode(HashLife *hl, NodeId id, int64_t x, int64_t y, World *w) {
+  QuadNode n = hl->nodes[id];
+  if (id == Empty(hl, n.level)) return;
+  if (n.level == HASHLIFE_LEAF_LEVEL) {
+    SetChunkValue(w, (int)(x / CHUNK_SIZE), (int)(y / CHUNK_SIZE), n.leaf);
+    return;
+  }
+  int64_t half = (int64_t)1 << (n.level - 1);
+  StoreNode(hl, n.quad.nw, x, y, w);
+  StoreNode(hl, n.quad.ne, x + half, y, w);
+  StoreNode(hl, n.quad.sw, x, y + half, w);
+  StoreNode(hl, n.quad.se, x + half, y + half, w);
+}
+
+void StoreHashLifeToWorld(HashLife *hl, World *w) {
+  SetWorldGeneration(w, hl->generation);
+  // The root origin is always chunk aligned: it only ever moves by multiples of 8 cells.
+  StoreNode(hl, hl->root, hl->originX, hl->originY, w);
+}
@@ -0,0 +1,61 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include "world.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// HashLife: the world as a canonical quadtree whose leaves are 8x8 chunks (level 3). Nodes are
+// hash-consed, so equal regions share one node, and every node memoises its RESULT: its centre
+// half advanced 2^stepLog2 generations. Repetitive patterns then advance exponentially fast.
+typedef uint32_t NodeId; // 0 is never a valid node
+
+#define HASHLIFE_LEAF_LEVEL 3
+#define HASHLIFE_MAX_LEVEL 60
+
+typedef struct QuadNode {
+  union {
+    struct { NodeId nw, ne, sw, se; } quad;
+    uint64_t leaf;
+  };
+  NodeId result; // Memoised RESULT for the current stepLog2, 0 if not computed yet
+  uint32_t hash;
+  uint8_t level;
+  uint8_t mark;
+} QuadNode;
+
+typedef struct HashLife {
+  QuadNode *nodes;
+  uint32_t count;
+  uint32_t capacity;
+  NodeId *table; // Open addressing over node ids
+  uint32_t tableCapacity;
+  NodeId empty[HASHLIFE_MAX_LEVEL + 1]; // Canonical empty node per level, 0 until first needed
+
+  NodeId root;
+  int64_t originX, originY; // Cell coordinates of the root's top-left corner
+  int stepLog2;
+  uint64_t generation;
+
+  size_t memoryLimit; // Soft cap in bytes, enforced between jumps
+  uint32_t gcCount;
+} HashLife;
+
+void InitHashLife(HashLife *hl, size_t memoryLimit);
+void FreeHashLife(HashLife *hl);
+size_t GetHashLifeMemory(const HashLife *hl);
+
+// Replaces the pattern with the live chunks of a world; the node cache is kept.
+void LoadHashLifeFromWorld(HashLife *hl, const World *w);
+// Same, but the root is centred on cell (0, 0) as Macrocell files expect, not fitted to the pattern.
+void LoadHashLifeCentred(HashLife *hl, const World *w);
+// Writes the pattern into w with SetChunkValue at the pattern's generation; w is expected to be empty.
+void StoreHashLifeToWorld(HashLife *hl, World *w);
+
+// Advances the pattern 2^k generations.
+void JumpHashLife(HashLife *hl, int k);
+// Drops the memoised results and every node not reachable from the root.
+void CollectHashLifeGarbage(HashLife *hl);
+
+#endif
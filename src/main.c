@@ -7,21 +7,30 @@ int main() {
   SetConfigFlags(FLAG_FULLSCREEN_MODE);
   SetTargetFPS(60);
   InitWindow(width, height, "Ray-of-Life");
+
+  // Pixels are written on the CPU and uploaded once per frame instead of one draw call each.
+  Image frame = GenImageColor(width, height, BLANK);
+  Texture2D texture = LoadTextureFromImage(frame);
+  Color *pixels = (Color *)frame.data;
+
   while (!WindowShouldClose()) {
+    for (int i = 0; i < width * height; i++) {
+      pixels[i] = (Color){ 
+        .r = 255,
+        .g = 0,
+        .b = 0,
+        .a = 255
+      };
+    }
+    UpdateTexture(texture, pixels);
+
     BeginDrawing();
-      for (int i = 0; i < width; i++) {
-        for (int j = 0; j < height; j++) {
-          DrawPixel(i, j, (Color){ 
-            .r = 255,
-            .g = 0,
-            .b = 0,
-            .a = 255
-          });
-        }
-      }
+      DrawTexture(texture, 0, 0, WHITE);
       DrawFPS(20, 20);
     EndDrawing();
   }
+  UnloadTexture(texture);
+  UnloadImage(frame);
   CloseWindow();
   return 0;
 }
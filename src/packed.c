@@ -0,0 +1,196 @@
+#include "packed.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PackedEntry {
+  uint64_t key;
+  uint64_t value;
+} PackedEntry;
+
+static int CompareEntries(const void *a, const void *b) {
+  uint64_t ka = ((const PackedEntry *)a)->key, kb = ((const PackedEntry *)b)->key;
+  return (ka > kb) - (ka < kb);
+}
+
+static inline uint32_t HashKey(uint64_t key) {
+  key *= 0x9e3779b97f4a7c15ULL;
+  return (uint32_t)(key >> 32);
+}
+
+static uint32_t FindKey(const PackedWorld *pw, uint64_t key) {
+  uint32_t mask = pw->lookupCapacity - 1;
+  for (uint32_t i = HashKey(key) & mask;; i = (i + 1) & mask) {
+    uint32_t j = pw->lookup[i];
+    if (j == UINT32_MAX) return pw->count;
+    if (pw->keys[j] == key) return j;
+  }
+}
+
+void InitPackedWorld(PackedWorld *pw) {
+  *pw = (PackedWorld){ 0 };
+}
+
+void FreePackedWorld(PackedWorld *pw) {
+  free(pw->cells);
+  free(pw->next);
+  free(pw->x);
+  free(pw->y);
+  free(pw->keys);
+  free(pw->neighbours);
+  free(pw->border);
+  free(pw->lookup);
+  *pw = (PackedWorld){ 0 };
+}
+
+static void ReservePacked(PackedWorld *pw, uint32_t count) {
+  if (count <= pw->capacity) return;
+  uint32_t capacity = count + count / 2;
+  pw->cells = realloc(pw->cells, (capacity + 1) * sizeof(uint64_t));
+  pw->next = realloc(pw->next, (capacity + 1) * sizeof(uint64_t));
+  pw->x = realloc(pw->x, capacity * sizeof(int32_t));
+  pw->y = realloc(pw->y, capacity * sizeof(int32_t));
+  pw->keys = realloc(pw->keys, capacity * sizeof(uint64_t));
+  pw->neighbours = realloc(pw->neighbours, capacity * sizeof(*pw->neighbours));
+  pw->border = realloc(pw->border, capacity * sizeof(uint32_t));
+  pw->capacity = capacity;
+}
+
+// entries[0, sorted) is already in curve order (the chunks being kept); the rest are sorted and
+// merged in, duplicates are combined, and every array is rebuilt from the result.
+static void RebuildPacked(PackedWorld *pw, PackedEntry *entries, uint32_t sorted, uint32_t count) {
+  qsort(entries + sorted, count - sorted, sizeof(PackedEntry), CompareEntries);
+  PackedEntry *merged = malloc((count + 1) * sizeof(PackedEntry));
+  uint32_t unique = 0;
+  for (uint32_t a = 0, b = sorted; a < sorted || b < count;) {
+    PackedEntry e = b == count || (a < sorted && entries[a].key <= entries[b].key) ? entries[a++] : entries[b++];
+    if (unique > 0 && merged[unique - 1].key == e.key) merged[unique - 1].value |= e.value;
+    else merged[unique++] = e;
+  }
+
+  ReservePacked(pw, unique);
+  pw->count = unique;
+  for (uint32_t i = 0; i < unique; i++) {
+    pw->keys[i] = merged[i].key;
+    pw->cells[i] = merged[i].value;
+    pw->x[i] = (int32_t)(CompactBits(merged[i].key) ^ 0x80000000u);
+    pw->y[i] = (int32_t)(CompactBits(merged[i].key >> 1) ^ 0x80000000u);
+  }
+  pw->cells[unique] = 0;
+  pw->next[unique] = 0;
+  free(merged);
+
+  uint32_t capacity = 16;
+  while (capacity < unique * 2) capacity <<= 1;
+  if (capacity > pw->lookupCapacity) {
+    free(pw->lookup);
+    pw->lookup = malloc(capacity * sizeof(uint32_t));
+    pw->lookupCapacity = capacity;
+  }
+  memset(pw->lookup, 0xFF, pw->lookupCapacity * sizeof(uint32_t));
+  uint32_t mask = pw->lookupCapacity - 1;
+  for (uint32_t i = 0; i < unique; i++) {
+    uint32_t h = HashKey(pw->keys[i]) & mask;
+    while (pw->lookup[h] != UINT32_MAX) h = (h + 1) & mask;
+    pw->lookup[h] = i;
+  }
+
+  pw->borderCount = 0;
+  for (uint32_t i = 0; i < unique; i++) {
+    bool border = false;
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      uint32_t j = FindKey(pw, MortonKey(pw->x[i] + NEIGHBOUR_DX[n], pw->y[i] + NEIGHBOUR_DY[n]));
+      pw->neighbours[i][n] = j;
+      border |= j == unique;
+    }
+    if (border) pw->border[pw->borderCount++] = i;
+  }
+}
+
+void PackWorld(PackedWorld *pw, const World *w) {
+  PackedEntry *entries = malloc((w->count + 1) * sizeof(PackedEntry));
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (node->c.chunk_value) entries[count++] = (PackedEntry){ MortonKey(node->x, node->y), node->c.chunk_value };
+  }
+  RebuildPacked(pw, entries, 0, count);
+  pw->generation = w->generation;
+  free(entries);
+}
+
+// When live edge cells are about to spill into a missing chunk, adds that chunk and its own
+// neighbours, and drops empty chunks with no live neighbour. Cells spread at most one per
+// generation, so the margin holds for CHUNK_SIZE generations before the next rebuild.
+static void ExpandPacked(PackedWorld *pw) {
+  uint32_t missing = 0;
+  for (uint32_t b = 0; b < pw->borderCount; b++) {
+    uint32_t i = pw->border[b];
+    for (int n = 0; n < MAX_NEIGHBOURS; n++)
+      if (pw->neighbours[i][n] == pw->count && (pw->cells[i] & NEIGHBOUR_EDGE[n])) missing++;
+  }
+  if (missing == 0) return;
+
+  PackedEntry *entries = malloc((pw->count + missing * (MAX_NEIGHBOURS + 1)) * sizeof(PackedEntry));
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < pw->count; i++) {
+    bool keep = pw->cells[i] != 0;
+    for (int n = 0; n < MAX_NEIGHBOURS && !keep; n++) keep = pw->cells[pw->neighbours[i][n]] != 0;
+    if (keep) entries[count++] = (PackedEntry){ pw->keys[i], pw->cells[i] };
+  }
+  uint32_t sorted = count;
+  for (uint32_t b = 0; b < pw->borderCount; b++) {
+    uint32_t i = pw->border[b];
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      if (pw->neighbours[i][n] != pw->count || !(pw->cells[i] & NEIGHBOUR_EDGE[n])) continue;
+      int32_t x = pw->x[i] + NEIGHBOUR_DX[n], y = pw->y[i] + NEIGHBOUR_DY[n];
+      entries[count++] = (PackedEntry){ MortonKey(x, y), 0 };
+      for (int m = 0; m < MAX_NEIGHBOURS; m++)
+        entries[count++] = (PackedEntry){ MortonKey(x + NEIGHBOUR_DX[m], y + NEIGHBOUR_DY[m]), 0 };
+    }
+  }
+  RebuildPacked(pw, entries, sorted, count);
+  free(entries);
+}
+
+#define PACKED_PREFETCH_DISTANCE 32
+
+static void StepPackedRange(void *ctx, uint32_t begin, uint32_t end) {
+  PackedWorld *pw = ctx;
+  ChunkLanes lanes;
+  for (uint32_t i = begin; i < end; i += STEP_LANES) {
+    // North and south neighbours sit further away along the curve than the rest; fetch ahead.
+    if (i + PACKED_PREFETCH_DISTANCE < end) {
+      __builtin_prefetch(&pw->cells[pw->neighbours[i + PACKED_PREFETCH_DISTANCE][NEIGHBOUR_N]]);
+      __builtin_prefetch(&pw->cells[pw->neighbours[i + PACKED_PREFETCH_DISTANCE][NEIGHBOUR_S]]);
+    }
+    uint32_t count = end - i < STEP_LANES ? end - i : STEP_LANES;
+    for (uint32_t l = 0; l < STEP_LANES; l++) {
+      uint32_t j = l < count ? i + l : pw->count;
+      lanes.c[l] = pw->cells[j];
+      for (int k = 0; k < MAX_NEIGHBOURS; k++)
+        lanes.n[k][l] = l < count ? pw->cells[pw->neighbours[j][k]] : 0;
+    }
+    uint64_t next[STEP_LANES];
+    StepChunkLanes(&lanes, next);
+    memcpy(&pw->next[i], next, count * sizeof(uint64_t));
+  }
+}
+
+uint32_t StepPackedWorld(PackedWorld *pw, Scheduler *s) {
+  ExpandPacked(pw);
+  RunParallel(s, pw->count, STEP_BATCH, StepPackedRange, pw);
+
+  uint64_t *cells = pw->cells;
+  pw->cells = pw->next;
+  pw->next = cells;
+  pw->cells[pw->count] = 0;
+  pw->generation++;
+  return pw->count;
+}
+
+uint64_t GetPackedPopulation(const PackedWorld *pw) {
+  uint64_t population = 0;
+  for (uint32_t i = 0; i < pw->count; i++) population += __builtin_popcountll(pw->cells[i]);
+  return population;
+}
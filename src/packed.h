@@ -0,0 +1,42 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include "chunk.h"
+#include "scheduler.h"
+#include "world.h"
+
+#include <stdint.h>
+
+// Structure-of-arrays chunk storage sorted along a Z-order (Morton) curve. The step loop streams
+// through `cells` and only touches the neighbour indices beside it; coordinates are cold and
+// only read when the chunk set changes. Every chunk is stepped each generation (no sleeping), so
+// this suits dense patterns and serves as a layout baseline for World.
+//
+// A missing neighbour points at index `count`, where cells[count] is always 0, so the gather
+// needs no branches. The arrays are rebuilt when live cells reach the border; new chunks are added
+// with a one-chunk margin, so that happens at most every few generations.
+typedef struct PackedWorld {
+  uint64_t *cells;
+  uint64_t *next;
+  int32_t *x;
+  int32_t *y;
+  uint64_t *keys; // Morton code of (x, y), ascending
+  uint32_t (*neighbours)[MAX_NEIGHBOURS];
+  uint32_t *border; // Chunks with at least one missing neighbour
+  uint32_t borderCount;
+  uint32_t *lookup; // Scratch hash from key to index, only used while rebuilding
+  uint32_t lookupCapacity;
+  uint32_t count;
+  uint32_t capacity;
+  uint64_t generation;
+} PackedWorld;
+
+void InitPackedWorld(PackedWorld *pw);
+void FreePackedWorld(PackedWorld *pw);
+// Replaces the contents with the live chunks of w.
+void PackWorld(PackedWorld *pw, const World *w);
+// Advances one generation and returns the number of chunks stepped.
+uint32_t StepPackedWorld(PackedWorld *pw, Scheduler *s);
+uint64_t GetPackedPopulation(const PackedWorld *pw);
+
+#endif
@@ -0,0 +1,444 @@
+#include "patternio.h"
+#include "hashlife.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RLE_LINE_WIDTH 70
+#define PATTERN_LINE_MAX 1024
+// Chunk coordinates are ints, so a Macrocell root may span at most 2^34 cells.
+#define MACROCELL_MAX_LEVEL 34
+
+typedef struct Reader {
+  FILE *in;
+  size_t pos, len;
+  unsigned char buffer[1 << 16];
+} Reader;
+
+static int PeekChar(Reader *r) {
+  if (r->pos == r->len) {
+    r->len = fread(r->buffer, 1, sizeof(r->buffer), r->in);
+    r->pos = 0;
+    if (r->len == 0) return EOF;
+  }
+  return r->buffer[r->pos];
+}
+
+static int NextChar(Reader *r) {
+  int c = PeekChar(r);
+  if (c != EOF) r->pos++;
+  return c;
+}
+
+// Reads up to the end of the line; returns false at end of stream or if the line is too long.
+static bool ReadLine(Reader *r, char *line, size_t size) {
+  size_t n = 0;
+  int c = NextChar(r);
+  if (c == EOF) return false;
+  for (; c != EOF && c != '\n'; c = NextChar(r)) {
+    if (c == '\r') continue;
+    if (n + 1 == size) return false;
+    line[n++] = (char)c;
+  }
+  line[n] = '\0';
+  return true;
+}
+
+static inline int FloorDiv8(int64_t a) {
+  return (int)((a >= 0 ? a : a - (CHUNK_SIZE - 1)) / CHUNK_SIZE);
+}
+
+// Collects bits for one chunk at a time and only touches the world when a run moves on to another
+// chunk, since consecutive runs almost always land in the same one.
+typedef struct CellWriter {
+  World *w;
+  int x, y;
+  uint64_t bits;
+} CellWriter;
+
+static void FlushCells(CellWriter *cw) {
+  if (!cw->bits) return;
+  ChunkNode *node = GetOrCreateChunk(cw->w, cw->x, cw->y);
+  if ((node->c.chunk_value | cw->bits) != node->c.chunk_value) {
+    node->c.chunk_value |= cw->bits;
+    WakeChunk(cw->w, node);
+  }
+  cw->bits = 0;
+}
+
+static void OrChunkBits(CellWriter *cw, int cx, int cy, uint64_t bits) {
+  if (cw->x != cx || cw->y != cy) {
+    FlushCells(cw);
+    cw->x = cx;
+    cw->y = cy;
+  }
+  cw->bits |= bits;
+}
+
+static void SetRun(CellWriter *cw, int64_t x, int64_t y, uint64_t length) {
+  int cy = FloorDiv8(y);
+  int row = (int)(y - (int64_t)cy * CHUNK_SIZE);
+  while (length > 0) {
+    int cx = FloorDiv8(x);
+    int col = (int)(x - (int64_t)cx * CHUNK_SIZE);
+    uint64_t take = (uint64_t)(CHUNK_SIZE - col) < length ? (uint64_t)(CHUNK_SIZE - col) : length;
+    uint64_t rowBits = ((1u << take) - 1) << col;
+    OrChunkBits(cw, cx, cy, rowBits << (row * BLOCK_SIZE));
+    x += take;
+    length -= take;
+  }
+}
+
+static void CopyRule(PatternInfo *info, const char *text) {
+  if (!info) return;
+  size_t n = 0;
+  while (text[n] && !isspace((unsigned char)text[n]) && text[n] != ',' && n + 1 < sizeof(info->rule)) n++;
+  memcpy(info->rule, text, n);
+  info->rule[n] = '\0';
+}
+
+static void ParseRLEHeader(const char *line, PatternInfo *info) {
+  if (!info) return;
+  const char *p;
+  if ((p = strchr(line, 'x')) && (p = strchr(p, '='))) info->width = strtoll(p + 1, NULL, 10);
+  if ((p = strstr(line, "y")) && (p = strchr(p, '='))) info->height = strtoll(p + 1, NULL, 10);
+  if ((p = strstr(line, "rule")) && (p = strchr(p, '='))) {
+    while (*++p == ' ') {}
+    CopyRule(info, p);
+  }
+}
+
+bool ReadRLE(World *w, FILE *in, int64_t x, int64_t y, PatternInfo *info) {
+  Reader *r = malloc(sizeof(Reader));
+  *r = (Reader){ .in = in };
+  if (info) *info = (PatternInfo){ 0 };
+  char line[PATTERN_LINE_MAX];
+
+  // Comment lines, then the optional "x = .., y = .., rule = .." header.
+  for (int c = PeekChar(r); c != EOF; c = PeekChar(r)) {
+    if (isspace(c)) {
+      NextChar(r);
+    } else if (c == '#') {
+      if (!ReadLine(r, line, sizeof(line))) break;
+      const char *p = strstr(line, "Pos=");
+      long long px, py;
+      if (strncmp(line, "#CXRLE", 6) == 0 && p && sscanf(p + 4, "%lld,%lld", &px, &py) == 2) {
+        x += px;
+        y += py;
+      }
+      if (strncmp(line, "#CXRLE", 6) == 0 && info && (p = strstr(line, "Gen="))) info->generation = strtoull(p + 4, NULL, 10);
+    } else {
+      if (c == 'x') {
+        if (!ReadLine(r, line, sizeof(line))) break;
+        ParseRLEHeader(line, info);
+      }
+      break;
+    }
+  }
+
+  CellWriter cw = { .w = w };
+  int64_t col = 0, row = 0;
+  uint64_t count = 0;
+  bool ok = false;
+  for (int c = NextChar(r); c != EOF; c = NextChar(r)) {
+    if (c >= '0' && c <= '9') {
+      if (count > (UINT64_C(1) << 40)) break;
+      count = count * 10 + (uint64_t)(c - '0');
+      continue;
+    }
+    if (isspace(c)) continue;
+    uint64_t n = count ? count : 1;
+    count = 0;
+    if (c == '!') {
+      ok = true;
+      break;
+    } else if (c == 'b' || c == '.') {
+      col += n;
+    } else if (c == '$') {
+      row += n;
+      col = 0;
+    } else if (c == 'o' || (c >= 'A' && c <= 'X') || (c >= 'p' && c <= 'y')) {
+      // Multi-state letters: A is live, B onwards the dying states, "pA".."yO" states 25 and up.
+      int state = c == 'o' ? 1 : c - 'A' + 1;
+      if (c >= 'p') {
+        int letter = NextChar(r);
+        if (letter < 'A' || letter > 'X') break;
+        state = 24 * (c - 'p' + 1) + letter - 'A' + 1;
+      }
+      if (state == 1) SetRun(&cw, x + col, y + row, n);
+      else if (w->planes) for (uint64_t i = 0; i < n; i++) SetWorldCellState(w, x + col + (int64_t)i, y + row, state);
+      col += n;
+    } else {
+      break;
+    }
+  }
+  FlushCells(&cw);
+  free(r);
+  return ok;
+}
+
+// Run tags are the RLE character, or RLE_STATE_TAG + state for multi-state cells.
+#define RLE_STATE_TAG 256
+
+typedef struct RLEWriter {
+  FILE *out;
+  int tag; // Pending run, 0 if none
+  uint64_t count;
+  int column;
+  char line[RLE_LINE_WIDTH + 2];
+} RLEWriter;
+
+static void FlushRun(RLEWriter *rw) {
+  if (!rw->tag) return;
+  char item[24];
+  int n = sizeof(item);
+  if (rw->tag < RLE_STATE_TAG) {
+    item[--n] = (char)rw->tag;
+  } else {
+    int state = rw->tag - RLE_STATE_TAG;
+    item[--n] = (char)('A' + (state - 1) % 24);
+    if (state > 24) item[--n] = (char)('p' + (state - 25) / 24);
+  }
+  if (rw->count > 1)
+    for (uint64_t c = rw->count; c > 0; c /= 10) item[--n] = (char)('0' + c % 10);
+  int length = (int)sizeof(item) - n;
+  if (rw->column + length > RLE_LINE_WIDTH) {
+    rw->line[rw->column++] = '\n';
+    fwrite(rw->line, 1, (size_t)rw->column, rw->out);
+    rw->column = 0;
+  }
+  memcpy(rw->line + rw->column, item + n, (size_t)length);
+  rw->column += length;
+  rw->tag = 0;
+}
+
+static void EmitRun(RLEWriter *rw, int tag, uint64_t count) {
+  if (count == 0) return;
+  if (rw->tag == tag) {
+    rw->count += count;
+    return;
+  }
+  FlushRun(rw);
+  rw->tag = tag;
+  rw->count = count;
+}
+
+static int CompareRowMajor(const void *a, const void *b) {
+  const ChunkNode *na = *(const ChunkNode *const *)a, *nb = *(const ChunkNode *const *)b;
+  if (na->y != nb->y) return (na->y > nb->y) - (na->y < nb->y);
+  return (na->x > nb->x) - (na->x < nb->x);
+}
+
+// State of the cell at bit index i of a node whose live or dying bit is set.
+static int NodeCellState(const World *w, const ChunkNode *node, int i) {
+  if (GetCell(node->c.chunk_value, i)) return 1;
+  int age = 0;
+  for (int p = 0; p < w->planes; p++) age |= (int)GetCell(node->dying[p], i) << p;
+  return age + 1;
+}
+
+// Generations worlds are written with Golly's multi-state letters so dying cells survive a save.
+bool WriteRLE(const World *w, FILE *out) {
+  ChunkNode **live = malloc((w->count ? w->count : 1) * sizeof(ChunkNode *));
+  uint32_t count = 0;
+  int64_t minX = 0, minY = 0, maxX = -1, maxY = -1;
+  for (uint32_t i = 0; i < w->count; i++) {
+    ChunkNode *node = w->nodes[i];
+    uint64_t v = node->c.chunk_value | GetDyingCells(w, node);
+    if (!v) continue;
+    uint8_t columns = 0;
+    for (int r = 0; r < CHUNK_SIZE; r++) columns |= (uint8_t)(v >> (r * BLOCK_SIZE));
+    int64_t x0 = (int64_t)node->x * CHUNK_SIZE + __builtin_ctz(columns);
+    int64_t x1 = (int64_t)node->x * CHUNK_SIZE + 31 - __builtin_clz(columns);
+    int64_t y0 = (int64_t)node->y * CHUNK_SIZE + __builtin_ctzll(v) / BLOCK_SIZE;
+    int64_t y1 = (int64_t)node->y * CHUNK_SIZE + (63 - __builtin_clzll(v)) / BLOCK_SIZE;
+    if (count == 0 || x0 < minX) minX = x0;
+    if (count == 0 || y0 < minY) minY = y0;
+    if (count == 0 || x1 > maxX) maxX = x1;
+    if (count == 0 || y1 > maxY) maxY = y1;
+    live[count++] = node;
+  }
+  qsort(live, count, sizeof(ChunkNode *), CompareRowMajor);
+
+  fprintf(out, "#CXRLE Pos=%lld,%lld Gen=%llu\n", (long long)minX, (long long)minY, (unsigned long long)w->generation);
+  char rule[RULE_TEXT_MAX];
+  FormatRule(GetStepRule(), rule);
+  fprintf(out, "x = %lld, y = %lld, rule = %s\n", (long long)(maxX - minX + 1), (long long)(maxY - minY + 1), rule);
+
+  RLEWriter rw = { .out = out };
+  int blank = w->planes ? '.' : 'b';
+  for (uint32_t begin = 0, end; begin < count; begin = end) {
+    int cy = live[begin]->y;
+    for (end = begin; end < count && live[end]->y == cy; end++) {}
+    if (begin > 0) EmitRun(&rw, '$', (uint64_t)CHUNK_SIZE * (cy - live[begin - 1]->y - 1));
+
+    for (int r = 0; r < CHUNK_SIZE; r++) {
+      int64_t y = (int64_t)cy * CHUNK_SIZE + r;
+      if (y < minY || y > maxY) continue;
+      int64_t cursor = minX;
+      for (uint32_t i = begin; i < end; i++) {
+        uint8_t bits = (uint8_t)((live[i]->c.chunk_value | GetDyingCells(w, live[i])) >> (r * BLOCK_SIZE));
+        while (bits) {
+          int col = __builtin_ctz(bits);
+          int64_t x = (int64_t)live[i]->x * CHUNK_SIZE + col;
+          bits &= bits - 1;
+          EmitRun(&rw, blank, (uint64_t)(x - cursor));
+          EmitRun(&rw, w->planes ? RLE_STATE_TAG + NodeCellState(w, live[i], r * BLOCK_SIZE + col) : 'o', 1);
+          cursor = x + 1;
+        }
+      }
+      if (y < maxY) EmitRun(&rw, '$', 1);
+    }
+  }
+  FlushRun(&rw);
+  fwrite(rw.line, 1, (size_t)rw.column, out);
+  fputs("!\n", out);
+  free(live);
+  return !ferror(out);
+}
+
+typedef struct MacrocellNode {
+  uint64_t leaf;
+  uint32_t child[4]; // nw, ne, sw, se as 1-based node numbers, 0 for empty
+  uint8_t level;
+} MacrocellNode;
+
+static bool ParseMacrocellLeaf(const char *line, uint64_t *leaf) {
+  int x = 0, y = 0;
+  *leaf = 0;
+  for (const char *p = line; *p; p++) {
+    if (*p == '$') {
+      y++;
+      x = 0;
+    } else if (*p == '.' || *p == '*') {
+      if (x >= CHUNK_SIZE || y >= CHUNK_SIZE) return false;
+      if (*p == '*') *leaf |= 1ULL << (y * BLOCK_SIZE + x);
+      x++;
+    } else if (!isspace((unsigned char)*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void PlaceMacrocellNode(CellWriter *cw, const MacrocellNode *nodes, uint32_t id, int64_t x, int64_t y) {
+  if (id == 0) return;
+  const MacrocellNode *n = &nodes[id - 1];
+  if (n->level == HASHLIFE_LEAF_LEVEL) {
+    if (!n->leaf) return;
+    if (x % CHUNK_SIZE == 0 && y % CHUNK_SIZE == 0) {
+      OrChunkBits(cw, FloorDiv8(x), FloorDiv8(y), n->leaf);
+    } else {
+      for (int r = 0; r < CHUNK_SIZE; r++)
+        for (int c = 0; c < CHUNK_SIZE; c++)
+          if (GetCell(n->leaf, r * BLOCK_SIZE + c)) SetRun(cw, x + c, y + r, 1);
+    }
+    return;
+  }
+  int64_t half = (int64_t)1 << (n->level - 1);
+  PlaceMacrocellNode(cw, nodes, n->child[0], x, y);
+  PlaceMacrocellNode(cw, nodes, n->child[1], x + half, y);
+  PlaceMacrocellNode(cw, nodes, n->child[2], x, y + half);
+  PlaceMacrocellNode(cw, nodes, n->child[3], x + half, y + half);
+}
+
+bool ReadMacrocell(World *w, FILE *in, int64_t x, int64_t y, PatternInfo *info) {
+  Reader *r = malloc(sizeof(Reader));
+  *r = (Reader){ .in = in };
+  if (info) *info = (PatternInfo){ 0 };
+  char line[PATTERN_LINE_MAX];
+  MacrocellNode *nodes = NULL;
+  uint32_t count = 0, capacity = 0;
+
+  bool ok = ReadLine(r, line, sizeof(line)) && strncmp(line, "[M2]", 4) == 0;
+  while (ok && ReadLine(r, line, sizeof(line))) {
+    if (line[0] == '#') {
+      if (info && line[1] == 'R') CopyRule(info, line + 2 + strspn(line + 2, " "));
+      if (info && line[1] == 'G') info->generation = strtoull(line + 2, NULL, 10);
+      continue;
+    }
+    if (line[0] == '\0') continue;
+
+    MacrocellNode node = { 0 };
+    if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+      node.level = HASHLIFE_LEAF_LEVEL;
+      ok = ParseMacrocellLeaf(line, &node.leaf);
+    } else {
+      unsigned long long level, c[4];
+      ok = sscanf(line, "%llu %llu %llu %llu %llu", &level, &c[0], &c[1], &c[2], &c[3]) == 5 &&
+           level > HASHLIFE_LEAF_LEVEL && level <= MACROCELL_MAX_LEVEL;
+      for (int i = 0; ok && i < 4; i++) {
+        // Children must already exist and be exactly one level down.
+        ok = c[i] <= count && (c[i] == 0 || nodes[c[i] - 1].level == level - 1);
+        node.child[i] = (uint32_t)c[i];
+      }
+      node.level = (uint8_t)level;
+    }
+    if (!ok) break;
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      nodes = realloc(nodes, capacity * sizeof(MacrocellNode));
+    }
+    nodes[count++] = node;
+  }
+
+  if (ok && count > 0) {
+    CellWriter cw = { .w = w };
+    int64_t half = (int64_t)1 << (nodes[count - 1].level - 1);
+    PlaceMacrocellNode(&cw, nodes, count, x - half, y - half);
+    FlushCells(&cw);
+  }
+  free(nodes);
+  free(r);
+  return ok && count > 0;
+}
+
+typedef struct MacrocellWriter {
+  const HashLife *hl;
+  uint32_t *lines; // Node id -> line number, 0 until written
+  uint32_t next;
+  FILE *out;
+} MacrocellWriter;
+
+// Writes the children before the node itself, since lines may only refer back.
+static uint32_t WriteMacrocellNode(MacrocellWriter *mw, NodeId id) {
+  const QuadNode *n = &mw->hl->nodes[id];
+  if (id == mw->hl->empty[n->level] && id != mw->hl->root) return 0;
+  if (mw->lines[id]) return mw->lines[id];
+
+  if (n->level == HASHLIFE_LEAF_LEVEL) {
+    int lastRow = n->leaf ? (63 - __builtin_clzll(n->leaf)) / BLOCK_SIZE : -1;
+    for (int r = 0; r <= lastRow; r++) {
+      uint8_t bits = (uint8_t)(n->leaf >> (r * BLOCK_SIZE));
+      for (int c = 0; bits >> c; c++) fputc((bits >> c) & 1 ? '*' : '.', mw->out);
+      fputc('$', mw->out);
+    }
+    if (lastRow < 0) fputc('$', mw->out);
+    fputc('\n', mw->out);
+  } else {
+    uint32_t nw = WriteMacrocellNode(mw, n->quad.nw);
+    uint32_t ne = WriteMacrocellNode(mw, n->quad.ne);
+    uint32_t sw = WriteMacrocellNode(mw, n->quad.sw);
+    uint32_t se = WriteMacrocellNode(mw, n->quad.se);
+    fprintf(mw->out, "%d %u %u %u %u\n", n->level, nw, ne, sw, se);
+  }
+  return mw->lines[id] = mw->next++;
+}
+
+bool WriteMacrocell(const World *w, FILE *out) {
+  // Leaves are written two-state, so a Generations world would lose its dying cells.
+  if (w->planes) return false;
+  HashLife hl;
+  InitHashLife(&hl, SIZE_MAX);
+  LoadHashLifeCentred(&hl, w);
+
+  char rule[RULE_TEXT_MAX];
+  FormatRule(GetStepRule(), rule);
+  fprintf(out, "[M2] (Ray-of-Life)\n#R %s\n#G %llu\n", rule, (unsigned long long)w->generation);
+  MacrocellWriter mw = { .hl = &hl, .lines = calloc(hl.count, sizeof(uint32_t)), .next = 1, .out = out };
+  WriteMacrocellNode(&mw, hl.root);
+  free(mw.lines);
+  FreeHashLife(&hl);
+  return !ferror(out);
+}
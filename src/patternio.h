@@ -0,0 +1,34 @@
+#ifndef PATTERNIO_H
+#define PATTERNIO_H
+
+#include "world.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Streaming readers and writers for the RLE and Macrocell (.mc) pattern formats. Cells go
+// straight between the stream and the chunk map: nothing dense is ever built, so memory stays
+// proportional to the live chunks (plus, for Macrocell, the file's node table).
+//
+// Readers OR live cells into the world at an offset and leave other cells alone. RLE also carries
+// the dying states of Generations rules as multi-state letters; states the world's rule does not
+// have read as dead, so a two-state world takes only the live cells. Macrocell is two-state only,
+// so Generations worlds are not written to it. RLE patterns start at their "#CXRLE Pos=" corner,
+// or (0, 0) without one; Macrocell roots are centred on (0, 0), as Golly does.
+typedef struct PatternInfo {
+  int64_t width, height; // From the RLE header, 0 if absent
+  uint64_t generation;   // From "#CXRLE Gen=" or "#G", 0 if absent
+  char rule[64];         // As written in the file, empty if absent
+} PatternInfo;
+
+// info may be NULL. Return false on a malformed stream; cells read before the error are kept.
+bool ReadRLE(World *w, FILE *in, int64_t x, int64_t y, PatternInfo *info);
+bool ReadMacrocell(World *w, FILE *in, int64_t x, int64_t y, PatternInfo *info);
+
+// Both record the current step rule. Return false if writing failed, or for WriteMacrocell if the
+// world has dying planes.
+bool WriteRLE(const World *w, FILE *out);
+bool WriteMacrocell(const World *w, FILE *out);
+
+#endif
@@ -0,0 +1,548 @@
+#include "period.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_SHAPE UINT32_MAX
+#define PHASE_CHUNKS (PERIOD_MAX_SIDE * PERIOD_MAX_SIDE)
+#define MOVER_BIN_SHIFT 4 // 16 chunks, the widest a mover's box can be
+
+bool InitPeriodTracker(PeriodTracker *t) {
+  *t = (PeriodTracker){ 0 };
+  if (GetRuleDyingPlanes(GetStepRule())) return false;
+  t->shapeTableCapacity = 256;
+  t->shapeTable = calloc(t->shapeTableCapacity, sizeof(uint32_t));
+  t->rejected = calloc(PERIOD_REJECTED_SIZE, sizeof(uint64_t));
+  t->history = calloc(PERIOD_HISTORY_SIZE, sizeof(PeriodHistoryEntry));
+  t->phaseChunks = malloc((PERIOD_MAX + 1) * PHASE_CHUNKS * sizeof(PeriodChunk));
+  InitWorld(&t->scratch, 64);
+  return true;
+}
+
+void ClearPeriodObjects(PeriodTracker *t) {
+  for (uint32_t i = 0; i < t->oscillatorCount; i++) free(t->oscillators[i].nodes);
+  t->oscillatorCount = 0;
+  t->moverCount = 0;
+  memset(t->history, 0, PERIOD_HISTORY_SIZE * sizeof(PeriodHistoryEntry));
+}
+
+void FreePeriodTracker(PeriodTracker *t) {
+  ClearPeriodObjects(t);
+  for (uint32_t i = 0; i < t->shapeCount; i++) free(t->shapes[i].phases);
+  free(t->shapes);
+  free(t->shapeTable);
+  free(t->rejected);
+  free(t->history);
+  free(t->oscillators);
+  free(t->movers);
+  FreeWorld(&t->scratch);
+  free(t->phaseChunks);
+  free(t->visited);
+  free(t->segments);
+  free(t->bins);
+  free(t->boxes);
+  free(t->landing);
+  *t = (PeriodTracker){ 0 };
+}
+
+static inline const uint64_t *ShapePhase(const PeriodShape *s, uint32_t phase) {
+  return s->phases + (size_t)phase * s->width * s->height;
+}
+
+// Anything that could touch a periodic object: cells, a blinker, or another object's chunk.
+static inline bool IsOccupied(const ChunkNode *node) {
+  return node->c.chunk_value || node->state == CHUNK_BLINKING || node->periodic;
+}
+
+static uint32_t FindShape(const PeriodTracker *t, uint64_t hash) {
+  uint32_t mask = t->shapeTableCapacity - 1;
+  for (uint32_t i = (uint32_t)hash & mask;; i = (i + 1) & mask) {
+    uint32_t slot = t->shapeTable[i];
+    if (!slot) return NO_SHAPE;
+    if (t->shapes[slot - 1].hash == hash) return slot - 1;
+  }
+}
+
+static void InsertShapeSlot(uint32_t *table, uint32_t capacity, uint64_t hash, uint32_t index) {
+  uint32_t mask = capacity - 1;
+  uint32_t i = (uint32_t)hash & mask;
+  while (table[i]) i = (i + 1) & mask;
+  table[i] = index + 1;
+}
+
+static uint32_t AddShape(PeriodTracker *t, PeriodShape shape) {
+  if (t->shapeCount == t->shapeCapacity) {
+    t->shapeCapacity = t->shapeCapacity ? t->shapeCapacity * 2 : 32;
+    t->shapes = realloc(t->shapes, t->shapeCapacity * sizeof(PeriodShape));
+  }
+  if ((t->shapeCount + 1) * 2 > t->shapeTableCapacity) {
+    uint32_t capacity = t->shapeTableCapacity * 2;
+    uint32_t *table = calloc(capacity, sizeof(uint32_t));
+    for (uint32_t i = 0; i < t->shapeCount; i++) InsertShapeSlot(table, capacity, t->shapes[i].hash, i);
+    free(t->shapeTable);
+    t->shapeTable = table;
+    t->shapeTableCapacity = capacity;
+  }
+  uint32_t index = t->shapeCount++;
+  t->shapes[index] = shape;
+  InsertShapeSlot(t->shapeTable, t->shapeTableCapacity, shape.hash, index);
+  return index;
+}
+
+static bool IsRejected(const PeriodTracker *t, uint64_t hash) {
+  uint32_t mask = PERIOD_REJECTED_SIZE - 1;
+  for (uint32_t i = (uint32_t)hash & mask; t->rejected[i]; i = (i + 1) & mask) {
+    if (t->rejected[i] == hash) return true;
+  }
+  return false;
+}
+
+// Soups produce endless one-off hashes, so the set is simply emptied when it fills up.
+static void Reject(PeriodTracker *t, uint64_t hash) {
+  if (!hash) return;
+  if (t->rejectedCount * 2 >= PERIOD_REJECTED_SIZE) {
+    memset(t->rejected, 0, PERIOD_REJECTED_SIZE * sizeof(uint64_t));
+    t->rejectedCount = 0;
+  }
+  uint32_t mask = PERIOD_REJECTED_SIZE - 1;
+  uint32_t i = (uint32_t)hash & mask;
+  while (t->rejected[i]) i = (i + 1) & mask;
+  t->rejected[i] = hash;
+  t->rejectedCount++;
+}
+
+// True if every chunk from (x0, y0) to (x1, y1) holds exactly the phase placed at (fx, fy), or
+// nothing when phase is NULL, and none of them is blinking or part of an oscillator.
+static bool IsRegionClear(const World *w, const PeriodShape *s, const uint64_t *phase, int fx, int fy, int x0,
+                          int y0, int x1, int y1) {
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      bool inside = phase && x >= fx && x < fx + s->width && y >= fy && y < fy + s->height;
+      uint64_t expected = inside ? phase[(y - fy) * s->width + (x - fx)] : 0;
+      const ChunkNode *node = FindChunk(w, x, y);
+      if (!node) {
+        if (expected) return false;
+        continue;
+      }
+      if (node->c.chunk_value != expected || node->state == CHUNK_BLINKING || node->periodic) return false;
+    }
+  }
+  return true;
+}
+
+void LocatePeriodMover(const PeriodTracker *t, const PeriodMover *m, uint64_t generation, int *x, int *y,
+                       uint32_t *phase) {
+  const PeriodShape *s = &t->shapes[m->shape];
+  uint64_t age = generation - m->start;
+  int64_t periods = (int64_t)(age / s->period);
+  *x = (int)(m->x + periods * s->dx);
+  *y = (int)(m->y + periods * s->dy);
+  *phase = (uint32_t)(age % s->period);
+}
+
+// Chunks the mover may touch before the next check: its footprint during this period and the next,
+// plus the margin.
+static void GetMoverBox(const PeriodTracker *t, const PeriodMover *m, uint64_t generation, int box[4]) {
+  const PeriodShape *s = &t->shapes[m->shape];
+  int x, y;
+  uint32_t phase;
+  LocatePeriodMover(t, m, generation, &x, &y, &phase);
+  box[0] = (s->dx < 0 ? x + s->dx : x) - PERIOD_MOVER_MARGIN;
+  box[1] = (s->dy < 0 ? y + s->dy : y) - PERIOD_MOVER_MARGIN;
+  box[2] = (s->dx > 0 ? x + s->dx : x) + s->width - 1 + PERIOD_MOVER_MARGIN;
+  box[3] = (s->dy > 0 ? y + s->dy : y) + s->height - 1 + PERIOD_MOVER_MARGIN;
+}
+
+// Mover boxes include the margin, so one margin between the two paths is enough.
+static inline bool AreMoverBoxesClose(const int *a, const int *b) {
+  int m = PERIOD_MOVER_MARGIN;
+  return a[0] <= b[2] - m && b[0] + m <= a[2] && a[1] <= b[3] - m && b[1] + m <= a[3];
+}
+
+// Movers with the same velocity keep their distance, which was at least a ring of empty chunks when
+// the later one was lifted, so they never need to look out for each other.
+static inline bool HaveSameVelocity(const PeriodShape *a, const PeriodShape *b) {
+  return a->dx * (int)b->period == b->dx * (int)a->period && a->dy * (int)b->period == b->dy * (int)a->period;
+}
+
+void RemovePeriodMover(PeriodTracker *t, uint32_t index) {
+  t->movers[index] = t->movers[--t->moverCount];
+}
+
+void VisitPeriodMovers(const PeriodTracker *t, uint64_t generation, PeriodChunkFn visit, void *ctx) {
+  for (uint32_t i = 0; i < t->moverCount; i++) {
+    const PeriodMover *m = &t->movers[i];
+    const PeriodShape *s = &t->shapes[m->shape];
+    int x, y;
+    uint32_t phase;
+    LocatePeriodMover(t, m, generation, &x, &y, &phase);
+    const uint64_t *values = ShapePhase(s, phase);
+    for (int j = 0; j < s->width * s->height; j++) {
+      if (values[j]) visit(ctx, x + j % s->width, y + j / s->width, values[j]);
+    }
+  }
+}
+
+static void LandMover(World *w, PeriodTracker *t, const PeriodMover *m) {
+  const PeriodShape *s = &t->shapes[m->shape];
+  int x, y;
+  uint32_t phase;
+  LocatePeriodMover(t, m, w->generation, &x, &y, &phase);
+  const uint64_t *values = ShapePhase(s, phase);
+  for (int j = 0; j < s->width * s->height; j++) {
+    if (!values[j]) continue;
+    int cx = x + j % s->width, cy = y + j / s->width;
+    const ChunkNode *node = FindChunk(w, cx, cy);
+    SetChunkValue(w, cx, cy, (node ? node->c.chunk_value : 0) | values[j]);
+  }
+  t->stats.landed++;
+}
+
+static void ReleaseOscillator(World *w, PeriodTracker *t, uint32_t index) {
+  PeriodOscillator *o = &t->oscillators[index];
+  const PeriodShape *s = &t->shapes[o->shape];
+  int count = s->width * s->height;
+  for (int j = 0; j < count; j++) o->nodes[j]->periodic = false;
+  for (int j = 0; j < count; j++) WakeChunk(w, o->nodes[j]);
+  free(o->nodes);
+  t->oscillators[index] = t->oscillators[--t->oscillatorCount];
+}
+
+void CyclePeriodOscillators(World *w) {
+  PeriodTracker *t = w->periods;
+  for (uint32_t i = 0; i < t->oscillatorCount; i++) {
+    PeriodOscillator *o = &t->oscillators[i];
+    const PeriodShape *s = &t->shapes[o->shape];
+    o->phase = o->phase + 1 == s->period ? 0 : o->phase + 1;
+    const uint64_t *values = ShapePhase(s, o->phase);
+    for (int j = 0; j < s->width * s->height; j++) {
+      ChunkNode *node = o->nodes[j];
+      // Queued since the last step, so the stepper has already advanced it.
+      if (node->state != CHUNK_CYCLING) continue;
+      node->prev = node->c;
+      node->c.chunk_value = values[j];
+      t->stats.cycledChunks++;
+    }
+  }
+}
+
+// Lands the movers that have something near their path, or that are near each other.
+static void CheckMovers(World *w, PeriodTracker *t) {
+  uint32_t count = t->moverCount;
+  if (count > t->binCapacity) {
+    t->binCapacity = count * 2;
+    t->bins = realloc(t->bins, t->binCapacity * sizeof(PeriodMoverBin));
+    t->boxes = realloc(t->boxes, t->binCapacity * 4 * sizeof(int));
+    t->landing = realloc(t->landing, t->binCapacity * sizeof(bool));
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    int *box = t->boxes + 4 * i;
+    GetMoverBox(t, &t->movers[i], w->generation, box);
+    t->landing[i] = !IsRegionClear(w, NULL, NULL, 0, 0, box[0], box[1], box[2], box[3]);
+    t->bins[i] = (PeriodMoverBin){ (uint64_t)(uint32_t)(box[1] >> MOVER_BIN_SHIFT) << 32 |
+                                   (uint32_t)(box[0] >> MOVER_BIN_SHIFT), i };
+  }
+
+  // Sorting by bin makes the movers in each of the 9 bins around a box a binary search away.
+  // Insertion sort: the movers barely change bins between checks.
+  for (uint32_t i = 1; i < count; i++) {
+    PeriodMoverBin bin = t->bins[i];
+    uint32_t j = i;
+    for (; j > 0 && t->bins[j - 1].key > bin.key; j--) t->bins[j] = t->bins[j - 1];
+    t->bins[j] = bin;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const int *box = t->boxes + 4 * i;
+    for (int by = -1; by <= 1 && !t->landing[i]; by++) {
+      for (int bx = -1; bx <= 1; bx++) {
+        uint64_t key = (uint64_t)(uint32_t)((box[1] >> MOVER_BIN_SHIFT) + by) << 32 |
+                       (uint32_t)((box[0] >> MOVER_BIN_SHIFT) + bx);
+        uint32_t lo = 0, hi = count;
+        while (lo < hi) {
+          uint32_t mid = lo + (hi - lo) / 2;
+          if (t->bins[mid].key < key) lo = mid + 1;
+          else hi = mid;
+        }
+        for (; lo < count && t->bins[lo].key == key; lo++) {
+          uint32_t other = t->bins[lo].mover;
+          if (other == i || HaveSameVelocity(&t->shapes[t->movers[i].shape], &t->shapes[t->movers[other].shape]))
+            continue;
+          if (AreMoverBoxesClose(box, t->boxes + 4 * other)) t->landing[i] = true;
+        }
+      }
+    }
+  }
+
+  // Backwards, so the mover swapped into a freed slot has already been decided.
+  for (uint32_t i = count; i-- > 0;) {
+    if (!t->landing[i]) continue;
+    LandMover(w, t, &t->movers[i]);
+    t->movers[i] = t->movers[--t->moverCount];
+  }
+}
+
+// Collects phase g's non-empty chunks from the scratch world in row order, with their bounding box.
+// Fails on an empty phase or one too large to be a shape.
+static bool RecordPhase(PeriodTracker *t, uint32_t g, int box[4]) {
+  const World *s = &t->scratch;
+  PeriodChunk *chunks = t->phaseChunks + g * PHASE_CHUNKS;
+  uint32_t n = 0;
+  box[0] = box[1] = INT_MAX;
+  box[2] = box[3] = INT_MIN;
+  for (uint32_t i = 0; i < s->count; i++) {
+    const ChunkNode *node = s->nodes[i];
+    if (!node->c.chunk_value) continue;
+    if (n == PHASE_CHUNKS) return false;
+    chunks[n++] = (PeriodChunk){ node->x, node->y, node->c.chunk_value };
+    if (node->x < box[0]) box[0] = node->x;
+    if (node->y < box[1]) box[1] = node->y;
+    if (node->x > box[2]) box[2] = node->x;
+    if (node->y > box[3]) box[3] = node->y;
+  }
+  if (!n || box[2] - box[0] >= PERIOD_MAX_SIDE || box[3] - box[1] >= PERIOD_MAX_SIDE) return false;
+  for (uint32_t i = 1; i < n; i++) {
+    PeriodChunk c = chunks[i];
+    uint32_t j = i;
+    for (; j > 0 && (chunks[j - 1].y > c.y || (chunks[j - 1].y == c.y && chunks[j - 1].x > c.x)); j--)
+      chunks[j] = chunks[j - 1];
+    chunks[j] = c;
+  }
+  t->phaseCounts[g] = n;
+  return true;
+}
+
+static bool IsShiftedPhase(const PeriodTracker *t, uint32_t g, int dx, int dy) {
+  if (t->phaseCounts[g] != t->phaseCounts[0]) return false;
+  const PeriodChunk *a = t->phaseChunks, *b = t->phaseChunks + g * PHASE_CHUNKS;
+  for (uint32_t i = 0; i < t->phaseCounts[0]; i++) {
+    if (b[i].x != a[i].x + dx || b[i].y != a[i].y + dy || b[i].value != a[i].value) return false;
+  }
+  return true;
+}
+
+// Runs the component alone from its corner until it repeats, possibly shifted. Returns the new
+// shape, or NO_SHAPE if it dies, grows too large or has no period up to PERIOD_MAX.
+static uint32_t VerifyShape(PeriodTracker *t, ChunkNode **nodes, uint32_t count, int minX, int minY,
+                            uint64_t hash) {
+  t->stats.verified++;
+  World *s = &t->scratch;
+  ClearWorld(s);
+  for (uint32_t i = 0; i < count; i++) {
+    if (nodes[i]->c.chunk_value) SetChunkValue(s, nodes[i]->x - minX, nodes[i]->y - minY, nodes[i]->c.chunk_value);
+  }
+  int footprint[4], box[4];
+  if (!RecordPhase(t, 0, footprint)) return NO_SHAPE;
+
+  for (uint32_t g = 1; g <= PERIOD_MAX; g++) {
+    StepWorld(s);
+    if (!RecordPhase(t, g, box)) return NO_SHAPE;
+    if (IsShiftedPhase(t, g, box[0], box[1])) {
+      PeriodShape shape = {
+        .hash = hash,
+        .period = g,
+        .dx = box[0],
+        .dy = box[1],
+        .offsetX = footprint[0],
+        .offsetY = footprint[1],
+        .width = footprint[2] - footprint[0] + 1,
+        .height = footprint[3] - footprint[1] + 1,
+      };
+      size_t size = (size_t)shape.width * shape.height;
+      shape.phases = calloc(g * size, sizeof(uint64_t));
+      for (uint32_t p = 0; p < g; p++) {
+        const PeriodChunk *chunks = t->phaseChunks + p * PHASE_CHUNKS;
+        for (uint32_t i = 0; i < t->phaseCounts[p]; i++) {
+          int x = chunks[i].x - footprint[0], y = chunks[i].y - footprint[1];
+          shape.phases[p * size + (size_t)y * shape.width + x] = chunks[i].value;
+        }
+      }
+      for (uint32_t i = 0; i < t->phaseCounts[0]; i++)
+        shape.population += (uint32_t)__builtin_popcountll(t->phaseChunks[i].value);
+      return AddShape(t, shape);
+    }
+    if (box[0] < footprint[0]) footprint[0] = box[0];
+    if (box[1] < footprint[1]) footprint[1] = box[1];
+    if (box[2] > footprint[2]) footprint[2] = box[2];
+    if (box[3] > footprint[3]) footprint[3] = box[3];
+    if (footprint[2] - footprint[0] >= PERIOD_MAX_SIDE || footprint[3] - footprint[1] >= PERIOD_MAX_SIDE)
+      return NO_SHAPE;
+  }
+  return NO_SHAPE;
+}
+
+// Period 1 and 2 already sleep and blink for free, so only longer periods are worth a table.
+static bool InstallOscillator(World *w, PeriodTracker *t, uint32_t index, int fx, int fy) {
+  PeriodShape *s = &t->shapes[index];
+  if (s->period <= 2) return false;
+  if (!IsRegionClear(w, s, s->phases, fx, fy, fx - 1, fy - 1, fx + s->width, fy + s->height)) return false;
+
+  if (t->oscillatorCount == t->oscillatorCapacity) {
+    t->oscillatorCapacity = t->oscillatorCapacity ? t->oscillatorCapacity * 2 : 64;
+    t->oscillators = realloc(t->oscillators, t->oscillatorCapacity * sizeof(PeriodOscillator));
+  }
+  int count = s->width * s->height;
+  PeriodOscillator *o = &t->oscillators[t->oscillatorCount++];
+  *o = (PeriodOscillator){ index, 0, malloc(count * sizeof(ChunkNode *)) };
+  const uint64_t *last = ShapePhase(s, s->period - 1);
+  for (int j = 0; j < count; j++) {
+    ChunkNode *node = GetOrCreateChunk(w, fx + j % s->width, fy + j / s->width);
+    node->state = CHUNK_CYCLING;
+    node->periodic = true;
+    node->changed = false;
+    node->prev.chunk_value = last[j];
+    o->nodes[j] = node;
+  }
+  s->detections++;
+  t->stats.oscillators++;
+  return true;
+}
+
+static bool InstallMover(World *w, PeriodTracker *t, uint32_t index, int fx, int fy) {
+  PeriodShape *s = &t->shapes[index];
+  PeriodMover mover = { index, fx, fy, w->generation };
+  int box[4];
+  GetMoverBox(t, &mover, w->generation, box);
+  if (!IsRegionClear(w, s, s->phases, fx, fy, box[0], box[1], box[2], box[3])) return false;
+  // Other movers are not in the world, so they need a look of their own.
+  for (uint32_t i = 0; i < t->moverCount; i++) {
+    int other[4];
+    if (HaveSameVelocity(s, &t->shapes[t->movers[i].shape])) continue;
+    GetMoverBox(t, &t->movers[i], w->generation, other);
+    if (AreMoverBoxesClose(box, other)) return false;
+  }
+
+  for (int j = 0; j < s->width * s->height; j++) {
+    if (s->phases[j]) SetChunkValue(w, fx + j % s->width, fy + j / s->width, 0);
+  }
+  if (t->moverCount == t->moverCapacity) {
+    t->moverCapacity = t->moverCapacity ? t->moverCapacity * 2 : 64;
+    t->movers = realloc(t->movers, t->moverCapacity * sizeof(PeriodMover));
+  }
+  t->movers[t->moverCount++] = mover;
+  s->detections++;
+  t->stats.spaceships++;
+  return true;
+}
+
+// Returns true if it installed an oscillator, whose chunks must then leave the active list.
+static bool ExamineComponent(World *w, PeriodTracker *t, ChunkNode **nodes, uint32_t count) {
+  uint64_t stamp = w->generation + 1;
+  int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+  for (uint32_t i = 0; i < count; i++) {
+    const ChunkNode *node = nodes[i];
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      const ChunkNode *other = node->Neighbours[n];
+      if (!other || (other->activeStamp == stamp && other->state == CHUNK_ACTIVE)) continue;
+      if (IsOccupied(other)) return false;
+    }
+    if (!node->c.chunk_value) continue;
+    if (node->x < minX) minX = node->x;
+    if (node->y < minY) minY = node->y;
+    if (node->x > maxX) maxX = node->x;
+    if (node->y > maxY) maxY = node->y;
+  }
+  if (minX > maxX || maxX - minX >= PERIOD_MAX_SIDE || maxY - minY >= PERIOD_MAX_SIDE) return false;
+
+  uint64_t hash = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (nodes[i]->c.chunk_value) hash += HashWorldChunk(nodes[i]->x - minX, nodes[i]->y - minY, nodes[i]->c.chunk_value);
+  }
+
+  uint32_t index = FindShape(t, hash);
+  if (index == NO_SHAPE && IsRejected(t, hash)) return false;
+  if (index == NO_SHAPE || t->recheckCached) {
+    PeriodHistoryEntry *entry = &t->history[hash & (PERIOD_HISTORY_SIZE - 1)];
+    bool repeated = entry->hash == hash && entry->generation < w->generation &&
+                    w->generation - entry->generation <= PERIOD_HISTORY_GENERATIONS;
+    *entry = (PeriodHistoryEntry){ hash, w->generation };
+    if (!repeated) return false;
+  }
+  if (index == NO_SHAPE) {
+    index = VerifyShape(t, nodes, count, minX, minY, hash);
+    if (index == NO_SHAPE) {
+      Reject(t, hash);
+      return false;
+    }
+  }
+  const PeriodShape *s = &t->shapes[index];
+  int fx = minX + s->offsetX, fy = minY + s->offsetY;
+  if (s->dx || s->dy) {
+    InstallMover(w, t, index, fx, fy);
+    return false;
+  }
+  return InstallOscillator(w, t, index, fx, fy);
+}
+
+// Splits the active chunks into components connected through active neighbours and examines the
+// small ones.
+static void DetectShapes(World *w, PeriodTracker *t) {
+  t->stats.samples++;
+  uint64_t stamp = w->generation + 1;
+  uint64_t mark = stamp | 1ULL << 63;
+  if (w->active.count > t->visitedCapacity) {
+    t->visitedCapacity = w->active.count * 2;
+    t->visited = realloc(t->visited, t->visitedCapacity * sizeof(ChunkNode *));
+  }
+  uint32_t visitedCount = 0, segmentCount = 0;
+  for (uint32_t i = 0; i < w->active.count; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (node->activeStamp != stamp || node->state != CHUNK_ACTIVE) continue;
+    uint32_t start = visitedCount;
+    node->activeStamp = mark;
+    t->visited[visitedCount++] = node;
+    for (uint32_t head = start; head < visitedCount; head++) {
+      ChunkNode *current = t->visited[head];
+      for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+        ChunkNode *other = current->Neighbours[n];
+        if (!other || other->activeStamp != stamp || other->state != CHUNK_ACTIVE) continue;
+        other->activeStamp = mark;
+        t->visited[visitedCount++] = other;
+      }
+    }
+    if (visitedCount - start > PERIOD_MAX_COMPONENT) continue;
+    if (segmentCount + 2 > t->segmentCapacity) {
+      t->segmentCapacity = t->segmentCapacity ? t->segmentCapacity * 2 : 256;
+      t->segments = realloc(t->segments, t->segmentCapacity * sizeof(uint32_t));
+    }
+    t->segments[segmentCount++] = start;
+    t->segments[segmentCount++] = visitedCount - start;
+  }
+  for (uint32_t i = 0; i < visitedCount; i++) t->visited[i]->activeStamp = stamp;
+
+  bool installed = false;
+  for (uint32_t i = 0; i < segmentCount; i += 2)
+    installed |= ExamineComponent(w, t, t->visited + t->segments[i], t->segments[i + 1]);
+  if (!installed) return;
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < w->active.count; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (node->state == CHUNK_CYCLING) node->activeStamp = 0;
+    else w->active.items[kept++] = node;
+  }
+  w->active.count = kept;
+}
+
+void UpdatePeriodTracker(World *w) {
+  PeriodTracker *t = w->periods;
+  if (t->moverCount && w->generation % PERIOD_MOVER_CHECK_INTERVAL == 0) CheckMovers(w, t);
+  // A chunk queued since the last cycle means something reached the oscillator.
+  for (uint32_t i = t->oscillatorCount; i-- > 0;) {
+    const PeriodOscillator *o = &t->oscillators[i];
+    const PeriodShape *s = &t->shapes[o->shape];
+    for (int j = 0; j < s->width * s->height; j++) {
+      if (o->nodes[j]->state == CHUNK_CYCLING) continue;
+      ReleaseOscillator(w, t, i);
+      t->stats.woken++;
+      break;
+    }
+  }
+  if (w->generation % PERIOD_SAMPLE_INTERVAL == 0) DetectShapes(w, t);
+}
+
+void RestorePeriodObjects(World *w) {
+  PeriodTracker *t = w->periods;
+  for (uint32_t i = 0; i < t->moverCount; i++) LandMover(w, t, &t->movers[i]);
+  t->moverCount = 0;
+  while (t->oscillatorCount) ReleaseOscillator(w, t, t->oscillatorCount - 1);
+}
@@ -0,0 +1,154 @@
+#ifndef PERIOD_H
+#define PERIOD_H
+
+#include "world.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Debris detection for two-state rules. A world with a PeriodTracker attached (World.periods)
+// stops stepping the oscillators and spaceships that soups leave behind.
+//
+// Every PERIOD_SAMPLE_INTERVAL generations the active chunks are split into connected components.
+// A small component with nothing else around it is hashed relative to its corner. If the same hash
+// was seen within PERIOD_HISTORY_GENERATIONS, the component is run alone in a scratch world for up
+// to PERIOD_MAX generations to find its period and its displacement. Verified shapes are cached
+// by hash, so later copies are recognised without simulating.
+//
+// An oscillator stays in the world, but its chunks become CHUNK_CYCLING. Each generation they copy
+// the next phase from the shape's table instead of being stepped. The stepper takes the whole
+// oscillator back as soon as anything queues one of its chunks.
+//
+// A spaceship is lifted out of the world into a mover, whose position is a function of the
+// generation. Every PERIOD_MOVER_CHECK_INTERVAL generations each mover looks PERIOD_MOVER_MARGIN
+// chunks around its path, and is written back into the world once anything is there.
+//
+// HashWorld and simulation snapshots include the movers. Other readers of the world see them only
+// after RestorePeriodObjects.
+#define PERIOD_MAX 64
+#define PERIOD_MAX_SIDE 6 // Footprint limit in chunks
+#define PERIOD_MAX_COMPONENT 96 // Active chunks, the quiet ring around the cells included
+#define PERIOD_SAMPLE_INTERVAL 4
+#define PERIOD_HISTORY_SIZE 4096 // Power of two
+#define PERIOD_HISTORY_GENERATIONS 128
+#define PERIOD_REJECTED_SIZE 65536 // Power of two; cleared when half full
+// Cells move at most one cell a generation, so with a margin of at least one chunk nothing can
+// reach a mover between two checks.
+#define PERIOD_MOVER_MARGIN 1
+#define PERIOD_MOVER_CHECK_INTERVAL 6
+
+// A verified periodic pattern. Phases are stored over its footprint: every chunk it touches
+// during one period, relative to the footprint corner at phase 0.
+typedef struct PeriodShape {
+  uint64_t hash; // Phase 0's non-empty chunks relative to their corner
+  uint64_t *phases; // period tables of width * height chunk values, rows first
+  uint32_t period;
+  int dx, dy; // Chunks moved per period; both 0 for oscillators
+  int offsetX, offsetY; // Footprint corner relative to the corner of phase 0's non-empty chunks
+  int width, height;
+  uint32_t population; // Live cells in phase 0
+  uint64_t detections;
+} PeriodShape;
+
+typedef struct PeriodOscillator {
+  uint32_t shape;
+  uint32_t phase;
+  ChunkNode **nodes; // The footprint, rows first
+} PeriodOscillator;
+
+typedef struct PeriodMover {
+  uint32_t shape;
+  int x, y; // Footprint corner at generation start, phase 0
+  uint64_t start;
+} PeriodMover;
+
+typedef struct PeriodStats {
+  uint64_t samples; // Detection passes
+  uint64_t verified; // Components simulated on their own
+  uint64_t oscillators; // Oscillators taken off the stepper
+  uint64_t spaceships; // Spaceships lifted into movers
+  uint64_t woken; // Oscillators handed back to the stepper
+  uint64_t landed; // Movers written back into the world
+  uint64_t cycledChunks; // Chunk updates served from phase tables
+} PeriodStats;
+
+typedef struct PeriodHistoryEntry {
+  uint64_t hash;
+  uint64_t generation;
+} PeriodHistoryEntry;
+
+// One non-empty chunk of a phase while a shape is verified.
+typedef struct PeriodChunk {
+  int x, y;
+  uint64_t value;
+} PeriodChunk;
+
+// Movers sorted by the 16-chunk bin of their box, to find the ones close to each other.
+typedef struct PeriodMoverBin {
+  uint64_t key;
+  uint32_t mover;
+} PeriodMoverBin;
+
+typedef struct PeriodTracker {
+  PeriodShape *shapes;
+  uint32_t shapeCount;
+  uint32_t shapeCapacity;
+  uint32_t *shapeTable; // Open addressing over shape index + 1
+  uint32_t shapeTableCapacity;
+  uint64_t *rejected; // Hashes of components that do not repeat, 0 for a free slot
+  uint32_t rejectedCount;
+  PeriodHistoryEntry *history; // Direct mapped by hash
+
+  PeriodOscillator *oscillators;
+  uint32_t oscillatorCount;
+  uint32_t oscillatorCapacity;
+  PeriodMover *movers;
+  uint32_t moverCount;
+  uint32_t moverCapacity;
+
+  World scratch; // Shapes are verified here
+  PeriodChunk *phaseChunks; // (PERIOD_MAX + 1) phases of up to PERIOD_MAX_SIDE^2 chunks
+  uint32_t phaseCounts[PERIOD_MAX + 1];
+  ChunkNode **visited; // Detection pass scratch: active chunks, one component after another
+  uint32_t visitedCapacity;
+  uint32_t *segments; // Start and length in visited of each component small enough to examine
+  uint32_t segmentCapacity;
+  PeriodMoverBin *bins; // Mover check scratch
+  int *boxes; // Four per mover
+  bool *landing;
+  uint32_t binCapacity;
+  // Cached shapes normally match at first sight. With this set they also wait for the repeat that
+  // would have verified them, so what is detected when does not depend on earlier worlds.
+  bool recheckCached;
+  PeriodStats stats;
+} PeriodTracker;
+
+// Uses the current step rule, so set it first. Returns false under a Generations rule, which the
+// tracker does not model.
+bool InitPeriodTracker(PeriodTracker *t);
+// Detach the tracker from its world (or free the world) first.
+void FreePeriodTracker(PeriodTracker *t);
+
+// Called by StepWorld: advances the oscillators one phase, after the active chunks were stepped.
+void CyclePeriodOscillators(World *w);
+// Called by StepWorld once the generation is complete: wakes oscillators, lands movers and looks
+// for new debris.
+void UpdatePeriodTracker(World *w);
+// Called by ClearWorld: drops every object along with the chunks, and the hash history. Cached
+// shapes are kept.
+void ClearPeriodObjects(PeriodTracker *t);
+// Writes every mover back and hands every oscillator to the stepper, so the world alone holds the
+// whole pattern again.
+void RestorePeriodObjects(World *w);
+
+// Footprint corner of a mover at the given generation, and the phase it is in.
+void LocatePeriodMover(const PeriodTracker *t, const PeriodMover *m, uint64_t generation, int *x, int *y,
+                       uint32_t *phase);
+// Forgets a mover without writing it back; the last mover takes its index.
+void RemovePeriodMover(PeriodTracker *t, uint32_t index);
+
+// Calls visit for each non-empty chunk of each mover at the given generation.
+typedef void (*PeriodChunkFn)(void *ctx, int x, int y, uint64_t value);
+void VisitPeriodMovers(const PeriodTracker *t, uint64_t generation, PeriodChunkFn visit, void *ctx);
+
+#endif
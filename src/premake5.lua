@@ -44,12 +44,53 @@ project "Menu-Test"
     filter "configurations:Release"
         optimize "On"
 
+project "Life"
+    kind "StaticLib"
+    language "C"
+    files { "chunk.h", "chunk.c", "chunkpool.h", "chunkpool.c", "halo.h", "halo.c", "hashlife.h", "hashlife.c", "packed.h", "packed.c", "patternio.h", "patternio.c", "period.h", "period.c", "profiler.h", "profiler.c", "raster.h", "raster.c", "rule.h", "rule.c", "scheduler.h", "scheduler.c", "simulation.h", "simulation.c", "snapshot.h", "snapshot.c", "world.h", "world.c" }
+
+    filter "configurations:Debug"
+        symbols "On"
+        buildoptions { "-DDEBUG" }
+
+    filter "configurations:Release"
+        optimize "On"
+
 project "Render-Test"
     kind "WindowedApp"
     language "C"
     files { "render_test.c" }
 
-    links { "raylib", "m" }
+    links { "Life", "raylib", "m", "pthread" }
+
+    filter "configurations:Debug"
+        symbols "On"
+        buildoptions { "-DDEBUG" }
+
+    filter "configurations:Release"
+        optimize "On"
+
+
+project "Bench"
+    kind "ConsoleApp"
+    language "C"
+    files { "bench.c" }
+
+    links { "Life", "m", "pthread" }
+
+    filter "configurations:Debug"
+        symbols "On"
+        buildoptions { "-DDEBUG" }
+
+    filter "configurations:Release"
+        optimize "On"
+
+project "Replay"
+    kind "ConsoleApp"
+    language "C"
+    files { "replay.c" }
+
+    links { "Life", "m", "pthread" }
 
     filter "configurations:Debug"
         symbols "On"
@@ -58,3 +99,30 @@ project "Render-Test"
     filter "configurations:Release"
         optimize "On"
 
+project "Soup"
+    kind "ConsoleApp"
+    language "C"
+    files { "soup.c" }
+
+    links { "Life", "m", "pthread" }
+
+    filter "configurations:Debug"
+        symbols "On"
+        buildoptions { "-DDEBUG" }
+
+    filter "configurations:Release"
+        optimize "On"
+
+project "Cluster"
+    kind "ConsoleApp"
+    language "C"
+    files { "cluster.c" }
+
+    links { "Life", "m", "pthread" }
+
+    filter "configurations:Debug"
+        symbols "On"
+        buildoptions { "-DDEBUG" }
+
+    filter "configurations:Release"
+        optimize "On"
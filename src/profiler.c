@@ -0,0 +1,140 @@
+#include "profiler.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+static const char *SCOPE_NAMES[PROFILE_SCOPE_COUNT] = {
+  "frame", "input", "sim step", "upload", "grid", "menu", "snapshot", "checkpoint", "hashlife", "cell prep",
+};
+
+static const char *COUNTER_NAMES[PROFILE_COUNTER_COUNT] = {
+  "active chunks", "live cells", "pool chunks", "allocations",
+};
+
+static const char *THREAD_NAMES[] = { "render", "simulation", "cell prep", "checkpoint writer" };
+
+double ProfileNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void InitProfiler(Profiler *p) {
+  memset(p, 0, sizeof(*p));
+  atomic_init(&p->tracing, false);
+  p->origin = ProfileNow();
+  p->frameStart = p->origin;
+  pthread_mutex_init(&p->traceLock, NULL);
+}
+
+void FreeProfiler(Profiler *p) {
+  StopProfilerTrace(p);
+  pthread_mutex_destroy(&p->traceLock);
+}
+
+// Call with traceLock held. Events are separated by ",\n" so the file stays one JSON array.
+__attribute__((format(printf, 2, 3))) static void WriteTraceEvent(Profiler *p, const char *format, ...) {
+  if (!p->traceEmpty) fputs(",\n", p->trace);
+  p->traceEmpty = false;
+  va_list args;
+  va_start(args, format);
+  vfprintf(p->trace, format, args);
+  va_end(args);
+}
+
+bool StartProfilerTrace(Profiler *p, const char *path) {
+  StopProfilerTrace(p);
+  FILE *file = fopen(path, "w");
+  if (!file) return false;
+  // A large buffer keeps the writes out of the frame; they land in bursts instead.
+  setvbuf(file, NULL, _IOFBF, 1 << 20);
+  fputs("[\n", file);
+
+  pthread_mutex_lock(&p->traceLock);
+  p->trace = file;
+  p->traceEmpty = true;
+  atomic_store(&p->tracing, true);
+  for (int t = 0; t < (int)(sizeof(THREAD_NAMES) / sizeof(THREAD_NAMES[0])); t++)
+    WriteTraceEvent(p, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", t,
+                    THREAD_NAMES[t]);
+  pthread_mutex_unlock(&p->traceLock);
+  return true;
+}
+
+void StopProfilerTrace(Profiler *p) {
+  pthread_mutex_lock(&p->traceLock);
+  FILE *file = p->trace;
+  p->trace = NULL;
+  atomic_store(&p->tracing, false);
+  pthread_mutex_unlock(&p->traceLock);
+  if (!file) return;
+  fputs("\n]\n", file);
+  fclose(file);
+}
+
+bool IsProfilerTracing(Profiler *p) {
+  return atomic_load(&p->tracing);
+}
+
+void TraceProfileScope(Profiler *p, ProfileScope scope, ProfileThread thread, double start, double end) {
+  if (!atomic_load(&p->tracing)) return;
+  pthread_mutex_lock(&p->traceLock);
+  if (p->trace) {
+    WriteTraceEvent(p, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", SCOPE_NAMES[scope],
+                    (int)thread, (start - p->origin) * 1e6, (end - start) * 1e6);
+  }
+  pthread_mutex_unlock(&p->traceLock);
+}
+
+static void TraceCounters(Profiler *p, const ProfileFrame *frame, double time) {
+  if (!atomic_load(&p->tracing)) return;
+  pthread_mutex_lock(&p->traceLock);
+  if (p->trace) {
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+      WriteTraceEvent(p, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.0f}}",
+                      COUNTER_NAMES[c], (time - p->origin) * 1e6, frame->counters[c]);
+    }
+  }
+  pthread_mutex_unlock(&p->traceLock);
+}
+
+void BeginProfileFrame(Profiler *p) {
+  double now = ProfileNow();
+  ProfileFrame *frame = &p->frames[p->current];
+  frame->milliseconds[PROFILE_FRAME] = (float)((now - p->frameStart) * 1e3);
+  TraceProfileScope(p, PROFILE_FRAME, PROFILE_THREAD_RENDER, p->frameStart, now);
+  TraceCounters(p, frame, now);
+
+  p->completed++;
+  p->current = (p->current + 1) % PROFILER_FRAMES;
+  memset(&p->frames[p->current], 0, sizeof(ProfileFrame));
+  p->frameStart = now;
+}
+
+void EndProfileScope(Profiler *p, ProfileScope scope, double start) {
+  double end = ProfileNow();
+  p->frames[p->current].milliseconds[scope] += (float)((end - start) * 1e3);
+  TraceProfileScope(p, scope, PROFILE_THREAD_RENDER, start, end);
+}
+
+void SetProfileScope(Profiler *p, ProfileScope scope, float milliseconds) {
+  p->frames[p->current].milliseconds[scope] = milliseconds;
+}
+
+void SetProfileCounter(Profiler *p, ProfileCounter counter, double value) {
+  p->frames[p->current].counters[counter] = value;
+}
+
+const ProfileFrame *GetProfileFrame(const Profiler *p, uint32_t age) {
+  if (age >= PROFILER_FRAMES - 1 || age >= p->completed) return NULL;
+  return &p->frames[(p->current + PROFILER_FRAMES - 1 - age) % PROFILER_FRAMES];
+}
+
+const char *GetProfileScopeName(ProfileScope scope) {
+  return SCOPE_NAMES[scope];
+}
+
+const char *GetProfileCounterName(ProfileCounter counter) {
+  return COUNTER_NAMES[counter];
+}
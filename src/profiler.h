@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame profiler: scoped CPU timers and counters kept for the last PROFILER_FRAMES frames, for a
+// rolling graph, and optionally streamed to a Chrome trace (chrome://tracing or Perfetto).
+//
+// The frame ring belongs to the render thread. Other threads, such as the simulation thread, may
+// only add trace events, which go through a lock.
+#define PROFILER_FRAMES 240
+
+typedef enum {
+  PROFILE_FRAME,
+  PROFILE_INPUT,
+  PROFILE_SIM_STEP,
+  PROFILE_UPLOAD,
+  PROFILE_GRID,
+  PROFILE_MENU,
+  PROFILE_SNAPSHOT,
+  PROFILE_CHECKPOINT,
+  PROFILE_HASHLIFE,
+  PROFILE_CELL_PREP,
+  PROFILE_SCOPE_COUNT
+} ProfileScope;
+
+typedef enum {
+  PROFILE_ACTIVE_CHUNKS,
+  PROFILE_LIVE_CELLS,
+  PROFILE_POOL_CHUNKS,
+  PROFILE_ALLOCATIONS, // Chunk slots allocated since the previous frame
+  PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+// Trace thread ids.
+typedef enum {
+  PROFILE_THREAD_RENDER,
+  PROFILE_THREAD_SIMULATION,
+  PROFILE_THREAD_CELL_PREP,
+  PROFILE_THREAD_CHECKPOINT
+} ProfileThread;
+
+typedef struct ProfileFrame {
+  float milliseconds[PROFILE_SCOPE_COUNT];
+  double counters[PROFILE_COUNTER_COUNT];
+} ProfileFrame;
+
+typedef struct Profiler {
+  ProfileFrame frames[PROFILER_FRAMES];
+  uint32_t current; // Frame being recorded
+  uint64_t completed;
+  double frameStart;
+  double origin; // Trace timestamps count from here
+  FILE *trace; // Guarded by traceLock
+  bool traceEmpty;
+  atomic_bool tracing; // Lets untraced calls skip the lock
+  pthread_mutex_t traceLock;
+} Profiler;
+
+// Seconds on a monotonic clock.
+double ProfileNow(void);
+
+void InitProfiler(Profiler *p);
+// Also finishes any trace in progress.
+void FreeProfiler(Profiler *p);
+
+// Starts writing trace events to path, replacing it. Returns false if it cannot be created.
+bool StartProfilerTrace(Profiler *p, const char *path);
+void StopProfilerTrace(Profiler *p);
+bool IsProfilerTracing(Profiler *p);
+
+// Closes the current frame (recording PROFILE_FRAME and the counters) and opens the next.
+void BeginProfileFrame(Profiler *p);
+// Adds the time since start (from ProfileNow) to scope in the current frame.
+void EndProfileScope(Profiler *p, ProfileScope scope, double start);
+// Sets a scope measured elsewhere, e.g. on another thread, without a trace event.
+void SetProfileScope(Profiler *p, ProfileScope scope, float milliseconds);
+void SetProfileCounter(Profiler *p, ProfileCounter counter, double value);
+// Trace event only; safe from any thread.
+void TraceProfileScope(Profiler *p, ProfileScope scope, ProfileThread thread, double start, double end);
+
+// age 0 is the last completed frame. Returns NULL past the recorded history.
+const ProfileFrame *GetProfileFrame(const Profiler *p, uint32_t age);
+const char *GetProfileScopeName(ProfileScope scope);
+const char *GetProfileCounterName(ProfileCounter counter);
+
+#endif
@@ -0,0 +1,215 @@
+#include "raster.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool ResizeCellRaster(CellRaster *r, int width, int height) {
+  r->width = width;
+  r->height = height;
+  if (width <= r->stride && height <= r->rows) return false;
+  r->stride = width > r->stride ? width : r->stride;
+  r->rows = height > r->rows ? height : r->rows;
+  free(r->pixels);
+  free(r->dirtyRows);
+  r->pixels = calloc((size_t)r->stride * r->rows, sizeof(uint32_t));
+  r->dirtyRows = calloc(r->rows, 1);
+  r->valid = false;
+  return true;
+}
+
+void FreeCellRaster(CellRaster *r) {
+  free(r->pixels);
+  free(r->dirtyRows);
+  free(r->squares);
+  free(r->nextSquares);
+  *r = (CellRaster){ 0 };
+}
+
+// Texels at the raster's lod, counted from cell 0; the ends are exclusive.
+typedef struct TexelRect {
+  int64_t x0, y0, x1, y1;
+} TexelRect;
+
+static inline TexelRect IntersectTexels(TexelRect a, TexelRect b) {
+  return (TexelRect){ a.x0 > b.x0 ? a.x0 : b.x0, a.y0 > b.y0 ? a.y0 : b.y0,
+                      a.x1 < b.x1 ? a.x1 : b.x1, a.y1 < b.y1 ? a.y1 : b.y1 };
+}
+
+static inline bool IsTexelRectEmpty(TexelRect a) {
+  return a.x0 >= a.x1 || a.y0 >= a.y1;
+}
+
+static inline bool ContainsTexels(TexelRect outer, TexelRect inner) {
+  return inner.x0 >= outer.x0 && inner.y0 >= outer.y0 && inner.x1 <= outer.x1 && inner.y1 <= outer.y1;
+}
+
+static inline int WrapTexel(int64_t t, int size) {
+  int64_t m = t % size;
+  return (int)(m < 0 ? m + size : m);
+}
+
+// Pixel row of texel row ty, marked for upload.
+static inline uint32_t *TexelRow(CellRaster *r, int64_t ty) {
+  int row = WrapTexel(ty, r->rows);
+  r->dirtyRows[row] = 1;
+  return r->pixels + (size_t)row * r->stride;
+}
+
+static void FillTexels(CellRaster *r, TexelRect rect, uint32_t colour) {
+  if (IsTexelRectEmpty(rect)) return;
+  int first = WrapTexel(rect.x0, r->stride);
+  int count = (int)(rect.x1 - rect.x0);
+  int head = count < r->stride - first ? count : r->stride - first;
+  for (int64_t y = rect.y0; y < rect.y1; y++) {
+    uint32_t *row = TexelRow(r, y);
+    for (int x = 0; x < head; x++) row[first + x] = colour;
+    for (int x = 0; x < count - head; x++) row[x] = colour;
+  }
+}
+
+static inline TexelRect SquareTexels(const CellRaster *r, const RasterSquare *s) {
+  int64_t x = ((int64_t)s->x * CHUNK_SIZE) >> r->lod;
+  int64_t y = ((int64_t)s->y * CHUNK_SIZE) >> r->lod;
+  int side = r->lod < 3 ? CHUNK_SIZE >> r->lod : 1;
+  return (TexelRect){ x, y, x + side, y + side };
+}
+
+// Density shading: never fainter than a quarter, so a lone cell in a large texel stays visible.
+static uint32_t ShadeDensity(uint32_t colour, uint64_t population, int lod) {
+  float density = (float)population / (float)((uint64_t)1 << 2 * lod);
+  float alpha = 64.0f + 191.0f * sqrtf(density > 1.0f ? 1.0f : density);
+  return (colour & 0x00FFFFFFu) | (uint32_t)alpha << 24;
+}
+
+// Writes every texel of the square inside clip, empty ones included, so it can overwrite an older
+// image of the square.
+static void DrawSquare(CellRaster *r, const RasterSquare *s, TexelRect clip) {
+  TexelRect whole = SquareTexels(r, s);
+  TexelRect rect = IntersectTexels(whole, clip);
+  if (IsTexelRectEmpty(rect)) return;
+  uint32_t alive = r->colours[0], dying = r->colours[1], dead = r->colours[2];
+
+  if (r->lod >= 3) {
+    TexelRow(r, rect.y0)[WrapTexel(rect.x0, r->stride)] = s->value ? ShadeDensity(alive, s->value, r->lod) : dying;
+    return;
+  }
+  // 1x1, 2x2 or 4x4 cells of the chunk per texel.
+  int side = 1 << r->lod;
+  uint64_t block = 0;
+  for (int row = 0; row < side; row++) block |= (uint64_t)((1u << side) - 1) << (row * BLOCK_SIZE);
+  for (int64_t ty = rect.y0; ty < rect.y1; ty++) {
+    uint32_t *out = TexelRow(r, ty);
+    int px = WrapTexel(rect.x0, r->stride);
+    int row = (int)(ty - whole.y0);
+    for (int64_t tx = rect.x0; tx < rect.x1; tx++) {
+      uint64_t mask = block << (row * side * BLOCK_SIZE + (int)(tx - whole.x0) * side);
+      uint64_t live = s->value & mask;
+      if (r->lod == 0) out[px] = live ? alive : s->dying & mask ? dying : dead;
+      else out[px] = live ? ShadeDensity(alive, (uint64_t)__builtin_popcountll(live), r->lod) : s->dying & mask ? dying : dead;
+      if (++px == r->stride) px = 0;
+    }
+  }
+}
+
+static void CollectSquare(void *ctx, int x, int y, const SnapshotChunk *chunks, uint32_t count, uint64_t population) {
+  CellRaster *r = ctx;
+  (void)count; // 1 below lod 3, and above it population stands for the chunks
+  if (r->nextCount == r->squareCapacity) {
+    r->squareCapacity = r->squareCapacity ? r->squareCapacity * 2 : 256;
+    r->squares = realloc(r->squares, r->squareCapacity * sizeof(RasterSquare));
+    r->nextSquares = realloc(r->nextSquares, r->squareCapacity * sizeof(RasterSquare));
+  }
+  // Below lod 3 every square is a single chunk.
+  r->nextSquares[r->nextCount++] = r->lod < 3 ? (RasterSquare){ MortonKey(x, y), x, y, chunks->value, chunks->dying }
+                                              : (RasterSquare){ MortonKey(x, y), x, y, population, 0 };
+}
+
+static inline int CellToChunk(int64_t a) {
+  int64_t chunk = (a >= 0 ? a : a - (CHUNK_SIZE - 1)) / CHUNK_SIZE;
+  return chunk < INT32_MIN ? INT32_MIN : chunk > INT32_MAX ? INT32_MAX : (int)chunk;
+}
+
+uint32_t UpdateCellRaster(CellRaster *r, const Snapshot *snap, uint32_t alive, uint32_t dying, uint32_t dead) {
+  uint32_t colours[3] = { alive, dying, dead };
+  bool sameColours = memcmp(colours, r->colours, sizeof(colours)) == 0;
+  bool sameLod = r->valid && r->lod == r->drawnLod;
+  bool sameView = sameLod && r->originX == r->drawnX && r->originY == r->drawnY && r->width == r->drawnWidth &&
+                  r->height == r->drawnHeight;
+  // The simulation thread only changes the world by stepping it, so the generation identifies the contents.
+  if (sameView && sameColours && snap->generation == r->drawnGeneration) return r->squareCount;
+
+  r->nextCount = 0;
+  int64_t x1 = r->originX + ((int64_t)r->width << r->lod) - 1;
+  int64_t y1 = r->originY + ((int64_t)r->height << r->lod) - 1;
+  QuerySnapshot(snap, CellToChunk(r->originX), CellToChunk(r->originY), CellToChunk(x1), CellToChunk(y1),
+                r->lod >= 3 ? r->lod - 3 : 0, CollectSquare, r);
+
+  memcpy(r->colours, colours, sizeof(colours));
+  TexelRect view = { r->originX >> r->lod, r->originY >> r->lod, 0, 0 };
+  view.x1 = view.x0 + r->width;
+  view.y1 = view.y0 + r->height;
+  TexelRect old = { r->drawnX >> r->lod, r->drawnY >> r->lod, 0, 0 };
+  old.x1 = old.x0 + r->drawnWidth;
+  old.y1 = old.y0 + r->drawnHeight;
+  TexelRect overlap = IntersectTexels(view, old);
+
+  if (!sameLod || !sameColours || IsTexelRectEmpty(overlap)) {
+    FillTexels(r, view, dead);
+    for (uint32_t i = 0; i < r->nextCount; i++) DrawSquare(r, &r->nextSquares[i], view);
+  } else {
+    // Clear what the old view did not cover: the rows above and below it, then the columns beside it.
+    FillTexels(r, (TexelRect){ view.x0, view.y0, view.x1, overlap.y0 }, dead);
+    FillTexels(r, (TexelRect){ view.x0, overlap.y1, view.x1, view.y1 }, dead);
+    FillTexels(r, (TexelRect){ view.x0, overlap.y0, overlap.x0, overlap.y1 }, dead);
+    FillTexels(r, (TexelRect){ overlap.x1, overlap.y0, view.x1, overlap.y1 }, dead);
+
+    // Both lists are in Morton order, so one merge finds the squares that appeared, vanished or
+    // changed, plus unchanged ones that were partly outside the old view.
+    uint32_t i = 0, j = 0;
+    while (i < r->squareCount || j < r->nextCount) {
+      const RasterSquare *before = i < r->squareCount ? &r->squares[i] : NULL;
+      const RasterSquare *after = j < r->nextCount ? &r->nextSquares[j] : NULL;
+      if (after && (!before || after->key < before->key)) {
+        DrawSquare(r, after, view);
+        j++;
+      } else if (before && (!after || before->key < after->key)) {
+        FillTexels(r, IntersectTexels(SquareTexels(r, before), view), dead);
+        i++;
+      } else {
+        if (before->value != after->value || before->dying != after->dying ||
+            !ContainsTexels(old, SquareTexels(r, after)))
+          DrawSquare(r, after, view);
+        i++;
+        j++;
+      }
+    }
+  }
+
+  RasterSquare *squares = r->squares;
+  r->squares = r->nextSquares;
+  r->nextSquares = squares;
+  r->squareCount = r->nextCount;
+  r->valid = true;
+  r->drawnLod = r->lod;
+  r->drawnX = r->originX;
+  r->drawnY = r->originY;
+  r->drawnWidth = r->width;
+  r->drawnHeight = r->height;
+  r->drawnGeneration = snap->generation;
+  return r->squareCount;
+}
+
+int TakeDirtyRows(CellRaster *r, int *row) {
+  int begin = *row;
+  while (begin < r->rows && !r->dirtyRows[begin]) begin++;
+  int end = begin;
+  while (end < r->rows && r->dirtyRows[end]) r->dirtyRows[end++] = 0;
+  *row = begin;
+  return end - begin;
+}
+
+void GetCellRasterCorner(const CellRaster *r, int *x, int *y) {
+  *x = WrapTexel(r->originX >> r->lod, r->stride);
+  *y = WrapTexel(r->originY >> r->lod, r->rows);
+}
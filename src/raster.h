@@ -0,0 +1,67 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "simulation.h"
+
+#include <stdint.h>
+
+// What was last drawn for one visited square: below lod 3 a chunk and its planes, above it a
+// square of chunks with its live cell count in value.
+typedef struct RasterSquare {
+  uint64_t key; // MortonKey of the corner chunk
+  int x, y;     // Corner chunk
+  uint64_t value, dying;
+} RasterSquare;
+
+// CPU-side image of a rectangle of cells, one RGBA8 texel per 2^lod x 2^lod cells, kept between
+// frames so only what changed is drawn again.
+//
+// The pixels wrap around: the texel covering cells (tx << lod, ty << lod) is always stored at
+// pixel (tx mod stride, ty mod rows). Moving the view therefore draws only the texels it exposes
+// and copies nothing; show the texture with repeat wrapping, from GetCellRasterCorner.
+typedef struct CellRaster {
+  uint32_t *pixels;
+  int width, height; // Texels covering the current view
+  int stride, rows;  // Allocated size
+  int lod; // log2 of the cells per texel side; 0 draws every cell
+  int64_t originX, originY; // Cell coordinates of the view's top-left texel, multiples of 2^lod
+
+  // The view, snapshot and colours the pixels currently show.
+  bool valid;
+  int drawnLod, drawnWidth, drawnHeight;
+  int64_t drawnX, drawnY;
+  uint64_t drawnGeneration;
+  uint32_t colours[3]; // alive, dying, dead
+  RasterSquare *squares; // Squares in the drawn view, in Morton order
+  RasterSquare *nextSquares; // Scratch for the next update
+  uint32_t squareCount, nextCount, squareCapacity;
+  uint8_t *dirtyRows; // Pixel rows written since TakeDirtyRows last returned them
+} CellRaster;
+
+// Packs a colour into the memory order of PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 (little-endian).
+static inline uint32_t PackRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16 | (uint32_t)a << 24;
+}
+
+// Makes sure the raster can hold width x height cells. Returns true if it had to reallocate, which
+// discards the image.
+bool ResizeCellRaster(CellRaster *r, int width, int height);
+void FreeCellRaster(CellRaster *r);
+
+// Brings the view up to date with the snapshot, with live cells in `alive`, dying cells in `dying`
+// and empty texels in `dead`. Above lod 0 each texel is `alive` with its alpha scaled by the live
+// density of its cells, so the cost follows the texel count rather than the chunk count.
+//
+// Only texels the view newly covers and squares that differ from the last update are drawn, and
+// nothing at all while neither the view nor the snapshot's generation changed. A change of lod or
+// colours, or a jump past the old view, redraws everything. Returns the number of squares in view.
+uint32_t UpdateCellRaster(CellRaster *r, const Snapshot *snap, uint32_t alive, uint32_t dying, uint32_t dead);
+
+// Finds the next run of pixel rows at or after *row written since they were last taken, clears it
+// and returns its length with *row at its start; 0 when there is none. Upload those rows only.
+int TakeDirtyRows(CellRaster *r, int *row);
+
+// Pixel holding the view's top-left texel.
+void GetCellRasterCorner(const CellRaster *r, int *x, int *y);
+
+#endif
@@ -1,8 +1,17 @@
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 
+#include "profiler.h"
+#include "raster.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "world.h"
+
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <stdbool.h>
 
@@ -35,12 +44,19 @@ typedef struct Config {
   bool debugText;
   bool debugGrid;
   bool debugChunkRenderer;
+  bool profilerOverlay;
   bool isChunkOnScreen;
+  bool simLockstep;
+  int simRate; // Generations per second, 0 = unlimited
+  int generationsPerFrame;
+  int jumpLog2;
   MenuState currentMenu;
   MenuState lastMenu;
 } Config;
 
 #define BASE_GRID_SIZE 50
+// At this zoom one screen pixel spans 2000 cells: a billion-cell world fits on screen.
+#define MIN_ZOOM 1e-5f
 
 Menu CreateMenu(const char *labels[], int buttonCount, Config cfg) {
   Menu menu = { .buttonCount = buttonCount, .verticalSpacing = 10.0f };
@@ -76,7 +92,78 @@ int DrawMenu(Menu menu) {
   return -1; // No button clicked
 }
 
-void draw_grid(Camera2D camera, Config cfg) {
+// The grid is a single quad covering the view. Its fragment shader measures the distance to the
+// nearest lattice point (or line) per pixel, so the cost depends on the window size, not on the
+// zoom, and the pattern fades out once dots shrink below a pixel or the lattice gets too dense.
+static const char *GRID_FRAGMENT_SHADER =
+  "#version 330\n"
+  "in vec2 fragTexCoord;\n"
+  "in vec4 fragColor;\n"
+  "uniform vec2 origin;\n"        // World position of the top-left pixel
+  "uniform float zoom;\n"         // Pixels per world unit
+  "uniform float screenHeight;\n"
+  "uniform float spacing;\n"      // World units between lattice points
+  "uniform float radius;\n"       // Dot radius in world units
+  "uniform int lines;\n"
+  "out vec4 finalColor;\n"
+  "void main() {\n"
+  "  vec2 world = origin + vec2(gl_FragCoord.x, screenHeight - gl_FragCoord.y) / zoom;\n"
+  "  vec2 d = abs(world - spacing * round(world / spacing)) * zoom;\n"
+  "  float alpha;\n"
+  "  if (lines != 0) {\n"
+  "    alpha = 1.0 - smoothstep(0.5, 1.0, min(d.x, d.y));\n"
+  "  } else {\n"
+  "    float r = radius * zoom;\n"
+  "    alpha = (1.0 - smoothstep(r - 0.5, r + 0.5, length(d))) * smoothstep(0.5, 1.0, r);\n"
+  "  }\n"
+  "  alpha *= smoothstep(2.0, 4.0, spacing * zoom);\n"
+  "  finalColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+  "}\n";
+
+typedef struct GridRenderer {
+  Shader shader;
+  int originLoc;
+  int zoomLoc;
+  int screenHeightLoc;
+  int spacingLoc;
+  int radiusLoc;
+  int linesLoc;
+} GridRenderer;
+
+GridRenderer LoadGridRenderer(void) {
+  GridRenderer grid = { .shader = LoadShaderFromMemory(NULL, GRID_FRAGMENT_SHADER) };
+  grid.originLoc = GetShaderLocation(grid.shader, "origin");
+  grid.zoomLoc = GetShaderLocation(grid.shader, "zoom");
+  grid.screenHeightLoc = GetShaderLocation(grid.shader, "screenHeight");
+  grid.spacingLoc = GetShaderLocation(grid.shader, "spacing");
+  grid.radiusLoc = GetShaderLocation(grid.shader, "radius");
+  grid.linesLoc = GetShaderLocation(grid.shader, "lines");
+  return grid;
+}
+
+void UnloadGridRenderer(GridRenderer *grid) {
+  UnloadShader(grid->shader);
+}
+
+// Draws a lattice of dots (or lines) every `spacing` world units; must be called inside BeginMode2D.
+void DrawGridPass(GridRenderer *grid, Camera2D camera, Config cfg, float spacing, float radius, bool lines, Color color) {
+  Vector2 topLeft = GetScreenToWorld2D((Vector2){ 0, 0 }, camera);
+  float screenHeight = (float)cfg.screenHeight;
+  int drawLines = lines;
+
+  SetShaderValue(grid->shader, grid->originLoc, &topLeft, SHADER_UNIFORM_VEC2);
+  SetShaderValue(grid->shader, grid->zoomLoc, &camera.zoom, SHADER_UNIFORM_FLOAT);
+  SetShaderValue(grid->shader, grid->screenHeightLoc, &screenHeight, SHADER_UNIFORM_FLOAT);
+  SetShaderValue(grid->shader, grid->spacingLoc, &spacing, SHADER_UNIFORM_FLOAT);
+  SetShaderValue(grid->shader, grid->radiusLoc, &radius, SHADER_UNIFORM_FLOAT);
+  SetShaderValue(grid->shader, grid->linesLoc, &drawLines, SHADER_UNIFORM_INT);
+
+  BeginShaderMode(grid->shader);
+    DrawRectangleV(topLeft, (Vector2){ cfg.screenWidth / camera.zoom, cfg.screenHeight / camera.zoom }, color);
+  EndShaderMode();
+}
+
+void draw_grid(GridRenderer *grid, Camera2D camera, Config cfg) {
   Vector2 topLeft = camera.target;
   Vector2 bottomRight = Vector2Add(camera.target, (Vector2){
     cfg.screenWidth / camera.zoom, 
@@ -98,28 +185,7 @@ void draw_grid(Camera2D camera, Config cfg) {
     DrawCircleV((Vector2){ startX, startY }, 10, BLUE);
   }
 
-  for (float y = startY; y <= bottomRight.y + 1; y += BASE_GRID_SIZE) {
-    Vector2 start = (Vector2){topLeft.x + 1, y};
-    Vector2 end = (Vector2){bottomRight.x + 1, y};  // Offset by 1
-    if (cfg.drawLines) {
-      DrawLineV(start, end, LIGHTGRAY);
-    }
-    else {
-      for (float x = startX; x <= bottomRight.x + 1; x += BASE_GRID_SIZE) {
-        Vector2 worldPos = {x, y};
-        Vector2 screenPos = worldPos;
-        DrawCircleV(screenPos, 3.0f, LIGHTGRAY); // Circles HOOOGGGG FPS for whatever reason!!!
-      }
-    }
-  }
-
-  for (float x = startX; x <= bottomRight.x + 1; x += BASE_GRID_SIZE) {
-    Vector2 start = (Vector2){x, topLeft.y + 1};  // Offset by 1
-    Vector2 end = (Vector2){x, bottomRight.y + 1};  // Offset by 1
-    if (cfg.drawLines) {
-      DrawLineV(start, end, LIGHTGRAY);
-    }
-  }
+  DrawGridPass(grid, camera, cfg, BASE_GRID_SIZE, 3.0f, cfg.drawLines, LIGHTGRAY);
 }
 
 void HandleControls(Config *cfg, Camera2D *camera) {
@@ -140,10 +206,11 @@ void HandleControls(Config *cfg, Camera2D *camera) {
   }
 
   if (!cfg->is_paused) {
+    // Zoom geometrically so the wheel feels the same at every scale, down to a whole-world view.
     float wheel = GetMouseWheelMove();
     if (wheel != 0) {
-      float zoomSpeed = 0.1f;
-      camera->zoom = Clamp(camera->zoom + wheel * zoomSpeed, 0.1f, 5.0f);
+      float zoomSpeed = 1.1f;
+      camera->zoom = Clamp(camera->zoom * powf(zoomSpeed, wheel), MIN_ZOOM, 5.0f);
     }
 
     if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
@@ -154,98 +221,236 @@ void HandleControls(Config *cfg, Camera2D *camera) {
   }
 }
 
-typedef union Block Block;
-union Block {
-  struct {
-    uint8_t a : 1;
-    uint8_t b : 1;
-    uint8_t c : 1;
-    uint8_t d : 1;
-    uint8_t e : 1;
-    uint8_t f : 1;
-    uint8_t g : 1;
-    uint8_t h : 1;
-  } cells;
-  unsigned char block_value;
-};
-
-#define CHUNK_SIZE 8
-#define BLOCK_SIZE 8
-
-typedef union Chunk Chunk;
-union Chunk {
-  struct {
-    Block a;
-    Block b;
-    Block c;
-    Block d;
-    Block e;
-    Block f;
-    Block g;
-    Block h;
-  } blocks;
-  uint64_t chunk_value;
-};
-
-#define MAX_NEIGHBOURS 8
-
-typedef struct ChunkNode ChunkNode; 
-struct ChunkNode {
-  Chunk c;
-  Chunk *Neighbours;
-  int x, y;
-};
-
-void DrawChunkGridDebug(Camera2D camera, Config cfg) {
-  float LOCAL_GRID = 400.0f;
+
+void DrawChunkGridDebug(GridRenderer *grid, Camera2D camera, Config cfg) {
+  DrawGridPass(grid, camera, cfg, 400.0f, 6.0f, false, BLUE);
+}
+
+// Cells are uploaded as one texel each and drawn as a single scaled quad, so the draw cost does
+// not depend on how many cells are alive. Zoomed out, one texel covers 2^lod x 2^lod cells, so
+// the texture never outgrows the window. The raster keeps its image between frames and wraps
+// around, so only the pixel rows it redrew are uploaded, and nothing while the view is still.
+//
+// A worker thread expands each frame's snapshot into the raster while the render thread draws the
+// previous frame's, so the cells on screen trail the camera by one frame. The handoff holds one
+// job: the render thread uploads the last result before it submits the next, and the raster is
+// only touched by whichever side holds the job.
+typedef struct CellPrepJob {
+  const Snapshot *snap; // Stays valid until the render thread acquires another
+  int lod, width, height;
+  int64_t originX, originY;
+} CellPrepJob;
+
+typedef struct CellRenderer {
+  CellRaster raster;
+  Texture2D texture;
+  // What the texture shows, copied from the raster when it was uploaded.
+  int lod, width, height, cornerX, cornerY;
+  int64_t originX, originY;
+
+  Profiler *profiler;
+  bool submitted; // Render thread only: a job is out and not yet collected
+  CellPrepJob job;
+  bool queued, done, resized, quit; // Guarded by lock
+  uint32_t visible;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t finished;
+  pthread_t thread;
+} CellRenderer;
+
+static void *CellPrepMain(void *arg) {
+  CellRenderer *renderer = arg;
+  CellRaster *raster = &renderer->raster;
+  pthread_mutex_lock(&renderer->lock);
+  for (;;) {
+    while (!renderer->queued && !renderer->quit) pthread_cond_wait(&renderer->wake, &renderer->lock);
+    if (renderer->quit) break;
+    CellPrepJob job = renderer->job;
+    renderer->queued = false;
+    pthread_mutex_unlock(&renderer->lock);
+
+    double start = ProfileNow();
+    raster->lod = job.lod;
+    raster->originX = job.originX;
+    raster->originY = job.originY;
+    bool resized = ResizeCellRaster(raster, job.width, job.height);
+    uint32_t visible = UpdateCellRaster(raster, job.snap, PackRGBA(GREEN.r, GREEN.g, GREEN.b, GREEN.a),
+                                        PackRGBA(DARKGREEN.r, DARKGREEN.g, DARKGREEN.b, DARKGREEN.a), 0);
+    TraceProfileScope(renderer->profiler, PROFILE_CELL_PREP, PROFILE_THREAD_CELL_PREP, start, ProfileNow());
+
+    pthread_mutex_lock(&renderer->lock);
+    renderer->resized = resized;
+    renderer->visible = visible;
+    renderer->done = true;
+    pthread_cond_signal(&renderer->finished);
+  }
+  pthread_mutex_unlock(&renderer->lock);
+  return NULL;
+}
+
+void StartCellRenderer(CellRenderer *renderer, Profiler *profiler) {
+  *renderer = (CellRenderer){ .profiler = profiler };
+  pthread_mutex_init(&renderer->lock, NULL);
+  pthread_cond_init(&renderer->wake, NULL);
+  pthread_cond_init(&renderer->finished, NULL);
+  pthread_create(&renderer->thread, NULL, CellPrepMain, renderer);
+}
+
+// Hands the worker the view for this frame; call CollectCells before the next AcquireSnapshot.
+void SubmitCells(CellRenderer *renderer, Config cfg, Camera2D camera, const Snapshot *snap) {
   Vector2 topLeft = camera.target;
   Vector2 bottomRight = Vector2Add(camera.target, (Vector2){
     cfg.screenWidth / camera.zoom, 
     cfg.screenHeight / camera.zoom
   });
 
-  float startX = topLeft.x + LOCAL_GRID;
-  float startY = topLeft.y + LOCAL_GRID;
+  // Smallest texel that still covers at least a screen pixel.
+  CellPrepJob job = { .snap = snap };
+  while (job.lod < 40 && BASE_GRID_SIZE * camera.zoom * (float)(1LL << job.lod) < 1.0f) job.lod++;
+  double texelSize = BASE_GRID_SIZE * (double)(1LL << job.lod);
+  int64_t texelX = (int64_t)floor(topLeft.x / texelSize);
+  int64_t texelY = (int64_t)floor(topLeft.y / texelSize);
+  job.originX = texelX * ((int64_t)1 << job.lod);
+  job.originY = texelY * ((int64_t)1 << job.lod);
+  job.width = (int)((int64_t)floor(bottomRight.x / texelSize) - texelX + 1);
+  job.height = (int)((int64_t)floor(bottomRight.y / texelSize) - texelY + 1);
+
+  pthread_mutex_lock(&renderer->lock);
+  renderer->job = job;
+  renderer->queued = true;
+  pthread_cond_signal(&renderer->wake);
+  pthread_mutex_unlock(&renderer->lock);
+  renderer->submitted = true;
+}
 
-  startX = floor(startX / LOCAL_GRID) * LOCAL_GRID;
-  startY = floor(startY / LOCAL_GRID) * LOCAL_GRID;
+// Waits for the job submitted last frame, if any, and uploads what it drew. Returns true if the
+// texture or the area it covers changed.
+bool CollectCells(CellRenderer *renderer, Config *cfg) {
+  if (!renderer->submitted) return false;
+  renderer->submitted = false;
+  pthread_mutex_lock(&renderer->lock);
+  while (!renderer->done) pthread_cond_wait(&renderer->finished, &renderer->lock);
+  renderer->done = false;
+  bool resized = renderer->resized;
+  cfg->isChunkOnScreen = renderer->visible > 0;
+  pthread_mutex_unlock(&renderer->lock);
+
+  // The texture always matches the raster's allocation, which is what the wrap-around addressing
+  // repeats over.
+  CellRaster *raster = &renderer->raster;
+  if (resized || renderer->texture.id == 0) {
+    if (renderer->texture.id != 0) UnloadTexture(renderer->texture);
+    Image image = GenImageColor(raster->stride, raster->rows, BLANK);
+    renderer->texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(renderer->texture, TEXTURE_FILTER_POINT);
+    SetTextureWrap(renderer->texture, TEXTURE_WRAP_REPEAT);
+  }
 
-  for (float y = startY; y <= bottomRight.y + 1; y += LOCAL_GRID) {
-    Vector2 start = (Vector2){topLeft.x + 1, y};
-    Vector2 end = (Vector2){bottomRight.x + 1, y};  // Offset by 1
-    for (float x = startX; x <= bottomRight.x + 1; x += LOCAL_GRID) {
-      Vector2 worldPos = {x, y};
-      Vector2 screenPos = worldPos;
-      DrawCircleV(screenPos, 6.0f, BLUE);
-    }
+  bool changed = false;
+  for (int row = 0, count; (count = TakeDirtyRows(raster, &row)) > 0; row += count) {
+    Rectangle rows = { 0, (float)row, (float)raster->stride, (float)count };
+    UpdateTextureRec(renderer->texture, rows, raster->pixels + (size_t)row * raster->stride);
+    changed = true;
   }
+
+  int cornerX, cornerY;
+  GetCellRasterCorner(raster, &cornerX, &cornerY);
+  changed = changed || renderer->lod != raster->lod || renderer->width != raster->width ||
+            renderer->height != raster->height || renderer->originX != raster->originX ||
+            renderer->originY != raster->originY || renderer->cornerX != cornerX || renderer->cornerY != cornerY;
+  renderer->lod = raster->lod;
+  renderer->width = raster->width;
+  renderer->height = raster->height;
+  renderer->originX = raster->originX;
+  renderer->originY = raster->originY;
+  renderer->cornerX = cornerX;
+  renderer->cornerY = cornerY;
+  return changed;
 }
 
-int GetCell(uint64_t value, int cell) {
-  return (value >> cell) & 1;  // Shift and mask the cell
+// Must be called inside BeginMode2D. Draws nothing until the first job was collected.
+void DrawCells(const CellRenderer *renderer) {
+  if (renderer->texture.id == 0) return;
+  double texelSize = BASE_GRID_SIZE * (double)(1LL << renderer->lod);
+  Rectangle source = { (float)renderer->cornerX, (float)renderer->cornerY, (float)renderer->width, (float)renderer->height };
+  Rectangle dest = {
+    (float)(renderer->originX * (double)BASE_GRID_SIZE),
+    (float)(renderer->originY * (double)BASE_GRID_SIZE),
+    (float)(renderer->width * texelSize),
+    (float)(renderer->height * texelSize),
+  };
+  DrawTexturePro(renderer->texture, source, dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
 }
 
-void DrawBlock(uint64_t blockValue, Vector2 basePos) {
-  const float CELL_SIZE = 50.0f;  // Each cell is 50x50 units
-  
-  for (int cell = 0; cell < 8; cell++) {
-    int isActive = GetCell(blockValue, cell);
-    if (isActive) {
-      Vector2 cellPos = {basePos.x + cell * CELL_SIZE, basePos.y};
-      DrawRectangleV(cellPos, (Vector2){CELL_SIZE, CELL_SIZE}, GREEN);  // Active cell
-    }
-  }
+void UnloadCellRenderer(CellRenderer *renderer) {
+  Config cfg = { 0 };
+  CollectCells(renderer, &cfg);
+  pthread_mutex_lock(&renderer->lock);
+  renderer->quit = true;
+  pthread_cond_signal(&renderer->wake);
+  pthread_mutex_unlock(&renderer->lock);
+  pthread_join(renderer->thread, NULL);
+  pthread_mutex_destroy(&renderer->lock);
+  pthread_cond_destroy(&renderer->wake);
+  pthread_cond_destroy(&renderer->finished);
+  if (renderer->texture.id != 0) UnloadTexture(renderer->texture);
+  FreeCellRaster(&renderer->raster);
 }
 
-void DrawChunk(Chunk c, Vector2 basePos) {
-  for (int block = 0; block < CHUNK_SIZE; block++) {
-    uint64_t blockValue = c.chunk_value >> (block * BLOCK_SIZE);
-    DrawBlock(blockValue, basePos);
-    basePos.y += BASE_GRID_SIZE;
+// The grid and cells are drawn into a screen-sized texture that is only redrawn when the camera,
+// the settings it depends on or the cells change; every other frame just copies it to the screen.
+typedef struct SceneCache {
+  RenderTexture2D target;
+  Camera2D camera;
+  bool drawLines;
+  bool debugGrid;
+  bool debugChunkRenderer;
+} SceneCache;
+
+bool IsSceneCacheStale(const SceneCache *scene, Camera2D camera, Config cfg) {
+  return scene->target.id == 0 || scene->target.texture.width != cfg.screenWidth ||
+         scene->target.texture.height != cfg.screenHeight || memcmp(&scene->camera, &camera, sizeof(camera)) != 0 ||
+         scene->drawLines != cfg.drawLines || scene->debugGrid != cfg.debugGrid ||
+         scene->debugChunkRenderer != cfg.debugChunkRenderer;
+}
+
+void RenderSceneCache(SceneCache *scene, GridRenderer *grid, const CellRenderer *cells, Camera2D camera, Config cfg) {
+  if (scene->target.texture.width != cfg.screenWidth || scene->target.texture.height != cfg.screenHeight) {
+    if (scene->target.id != 0) UnloadRenderTexture(scene->target);
+    scene->target = LoadRenderTexture(cfg.screenWidth, cfg.screenHeight);
   }
+  BeginTextureMode(scene->target);
+    ClearBackground(RAYWHITE);
+    BeginMode2D(camera);
+      draw_grid(grid, camera, cfg);
+      if (cfg.debugChunkRenderer) {
+        DrawChunkGridDebug(grid, camera, cfg);
+        DrawCells(cells);
+      }
+    EndMode2D();
+  EndTextureMode();
+  scene->camera = camera;
+  scene->drawLines = cfg.drawLines;
+  scene->debugGrid = cfg.debugGrid;
+  scene->debugChunkRenderer = cfg.debugChunkRenderer;
 }
 
-void DrawChunkNodeDebug(Config *cfg, Camera2D camera, ChunkNode c) {
+// Copied without blending: the cached pixels are already composited over the background.
+void DrawSceneCache(const SceneCache *scene) {
+  Rectangle source = { 0, 0, (float)scene->target.texture.width, -(float)scene->target.texture.height };
+  rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+  BeginBlendMode(BLEND_CUSTOM);
+    DrawTextureRec(scene->target.texture, source, (Vector2){ 0, 0 }, WHITE);
+  EndBlendMode();
+}
+
+void UnloadSceneCache(SceneCache *scene) {
+  if (scene->target.id != 0) UnloadRenderTexture(scene->target);
+}
+
+void DrawChunkNodeDebug(Config *cfg, Camera2D camera, const SnapshotChunk *c) {
   const float LOCAL_GRID_SIZE = 400.0f;
   Vector2 topLeft = camera.target;
   Vector2 bottomRight = Vector2Add(camera.target, (Vector2){
@@ -254,37 +459,172 @@ void DrawChunkNodeDebug(Config *cfg, Camera2D camera, ChunkNode c) {
   });
 
   Vector2 chunkPos = {
-    c.x * LOCAL_GRID_SIZE,
-    c.y * LOCAL_GRID_SIZE,
+    c->x * LOCAL_GRID_SIZE,
+    c->y * LOCAL_GRID_SIZE,
   };
 
  if (chunkPos.x + LOCAL_GRID_SIZE < topLeft.x || chunkPos.x > bottomRight.x ||
      chunkPos.y + LOCAL_GRID_SIZE < topLeft.y || chunkPos.y > bottomRight.y) {
-    cfg->isChunkOnScreen = false;
     return;
   }
 
-  cfg->isChunkOnScreen = true;
-  DrawChunk(c.c, chunkPos);
   DrawCircleV(chunkPos, 9.0f, RED);
   Vector2 endPos = Vector2Add(chunkPos, (Vector2){ LOCAL_GRID_SIZE, LOCAL_GRID_SIZE});
   DrawCircleV(endPos, 9.0f, RED);
 }
 
+typedef struct ChunkMarkers {
+  Config *cfg;
+  Camera2D camera;
+} ChunkMarkers;
+
+static void DrawChunkMarkers(void *ctx, int x, int y, const SnapshotChunk *chunks, uint32_t count, uint64_t population) {
+  ChunkMarkers *markers = ctx;
+  (void)x;
+  (void)y;
+  (void)population;
+  for (uint32_t i = 0; i < count; i++) DrawChunkNodeDebug(markers->cfg, markers->camera, &chunks[i]);
+}
+
+// Asks the snapshot index for the chunks under the view instead of testing every chunk.
+void DrawVisibleChunks(ChunkMarkers *markers, const Snapshot *snap) {
+  const float LOCAL_GRID_SIZE = 400.0f;
+  Vector2 topLeft = markers->camera.target;
+  Vector2 bottomRight = Vector2Add(topLeft, (Vector2){
+    markers->cfg->screenWidth / markers->camera.zoom,
+    markers->cfg->screenHeight / markers->camera.zoom
+  });
+  QuerySnapshot(snap, (int)floor(topLeft.x / LOCAL_GRID_SIZE), (int)floor(topLeft.y / LOCAL_GRID_SIZE),
+                (int)floor(bottomRight.x / LOCAL_GRID_SIZE), (int)floor(bottomRight.y / LOCAL_GRID_SIZE), 0,
+                DrawChunkMarkers, markers);
+}
+
 void FillChunk(Chunk *c) {
   for (int block = 0; block < CHUNK_SIZE; block++)
     c->chunk_value |= ((uint64_t)((uint8_t)rand() % 256) << (block * BLOCK_SIZE));
 }
 
-int main() {
-  srand(time(NULL));
-  Config cfg = { 800, 450, false, false, false, false, false, false, false, MENU_NONE, MENU_PAUSE};
+void SeedWorld(World *w) {
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      Chunk c = { 0 };
+      FillChunk(&c);
+      SetChunkValue(w, x, y, c.chunk_value);
+    }
+  }
+}
+
+#define MAX_SIM_RATE (1 << 20)
+#define CHECKPOINT_PATH "render_test.life"
+// Written while the profiler overlay is on; open it in chrome://tracing or Perfetto.
+#define PROFILE_TRACE_PATH "render_test.trace.json"
+
+#define PROFILE_GRAPH_HEIGHT 120
+#define PROFILE_GRAPH_MS 33.3f // Full graph height
+
+static const Color PROFILE_COLORS[PROFILE_SCOPE_COUNT] = { RAYWHITE, SKYBLUE, ORANGE, LIME, VIOLET, PINK, YELLOW, RED, GOLD, BEIGE };
+
+// Rolling graph of the last PROFILER_FRAMES frames, one line per scope timed on this thread plus
+// the simulation step, with the 60 fps budget marked, and the latest counters beside it.
+void DrawProfilerOverlay(const Profiler *profiler, Config cfg) {
+  int left = 10, bottom = cfg.screenHeight - 10, top = bottom - PROFILE_GRAPH_HEIGHT;
+  float scale = PROFILE_GRAPH_HEIGHT / PROFILE_GRAPH_MS;
+  DrawRectangle(left, top, PROFILER_FRAMES, PROFILE_GRAPH_HEIGHT, Fade(BLACK, 0.6f));
+  DrawLine(left, bottom - (int)(16.7f * scale), left + PROFILER_FRAMES, bottom - (int)(16.7f * scale), Fade(WHITE, 0.4f));
+
+  for (int scope = PROFILE_FRAME; scope <= PROFILE_MENU; scope++) {
+    for (uint32_t age = 0; age + 1 < PROFILER_FRAMES; age++) {
+      const ProfileFrame *frame = GetProfileFrame(profiler, age);
+      const ProfileFrame *older = GetProfileFrame(profiler, age + 1);
+      if (!older) break;
+      float y0 = fmaxf(bottom - frame->milliseconds[scope] * scale, (float)top);
+      float y1 = fmaxf(bottom - older->milliseconds[scope] * scale, (float)top);
+      float x = (float)(left + PROFILER_FRAMES - age);
+      DrawLineV((Vector2){ x, y0 }, (Vector2){ x - 1, y1 }, PROFILE_COLORS[scope]);
+    }
+  }
+
+  const ProfileFrame *latest = GetProfileFrame(profiler, 0);
+  if (!latest) return;
+  int textX = left + PROFILER_FRAMES + 10, textY = top;
+  for (int scope = PROFILE_FRAME; scope <= PROFILE_MENU; scope++, textY += 12) {
+    DrawText(TextFormat("%s %.2f ms", GetProfileScopeName(scope), latest->milliseconds[scope]), textX, textY, 10,
+             PROFILE_COLORS[scope]);
+  }
+  for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++, textY += 12)
+    DrawText(TextFormat("%s %.0f", GetProfileCounterName(counter), latest->counters[counter]), textX, textY, 10, DARKGRAY);
+}
+
+void RecordProfileCounters(Profiler *profiler, const Snapshot *snap, uint64_t *lastAllocations) {
+  SetProfileScope(profiler, PROFILE_SIM_STEP, snap->stepMilliseconds);
+  SetProfileCounter(profiler, PROFILE_ACTIVE_CHUNKS, snap->activeChunks);
+  SetProfileCounter(profiler, PROFILE_LIVE_CELLS, (double)snap->population);
+  SetProfileCounter(profiler, PROFILE_POOL_CHUNKS, snap->pool.live);
+  SetProfileCounter(profiler, PROFILE_ALLOCATIONS, (double)(snap->pool.allocations - *lastAllocations));
+  *lastAllocations = snap->pool.allocations;
+}
+
+// The trace runs exactly while the overlay is shown.
+void SetProfilerOverlay(Config *cfg, Profiler *profiler, bool on) {
+  cfg->profilerOverlay = on;
+  if (!on) StopProfilerTrace(profiler);
+  else if (!StartProfilerTrace(profiler, PROFILE_TRACE_PATH)) TraceLog(LOG_WARNING, "Cannot write %s", PROFILE_TRACE_PATH);
+}
+
+// 4 switches between a gen/s target and a fixed number of generations per frame; +/- double or
+// halve whichever is active. A rate of 0 means unlimited.
+void HandleSimulationControls(Config *cfg, Simulation *sim) {
+  bool changed = false;
+  if (IsKeyPressed(KEY_FOUR)) { cfg->simLockstep = !cfg->simLockstep; changed = true; }
+  if (IsKeyPressed(KEY_EQUAL)) {
+    if (cfg->simLockstep) cfg->generationsPerFrame *= 2;
+    else if (cfg->simRate) cfg->simRate = cfg->simRate >= MAX_SIM_RATE ? 0 : cfg->simRate * 2;
+    changed = true;
+  }
+  if (IsKeyPressed(KEY_MINUS)) {
+    if (cfg->simLockstep) cfg->generationsPerFrame = cfg->generationsPerFrame > 1 ? cfg->generationsPerFrame / 2 : 1;
+    else if (cfg->simRate == 0) cfg->simRate = MAX_SIM_RATE;
+    else if (cfg->simRate > 1) cfg->simRate /= 2;
+    changed = true;
+  }
+
+  if (changed) {
+    if (cfg->simLockstep) SetSimulationLockstep(sim, cfg->generationsPerFrame);
+    else SetSimulationRate(sim, cfg->simRate);
+  }
+  // J skips 2^jumpLog2 generations with HashLife; [ and ] pick the exponent.
+  if (IsKeyPressed(KEY_LEFT_BRACKET) && cfg->jumpLog2 > 0) cfg->jumpLog2--;
+  if (IsKeyPressed(KEY_RIGHT_BRACKET) && cfg->jumpLog2 < 40) cfg->jumpLog2++;
+  if (IsKeyPressed(KEY_J) && !cfg->is_paused && !RequestHashLifeJump(sim, cfg->jumpLog2))
+    TraceLog(LOG_WARNING, "HashLife jumps need a two-state rule");
+  if (IsKeyPressed(KEY_F5)) RequestCheckpoint(sim);
+
+  SetSimulationPaused(sim, cfg->is_paused || !cfg->debugChunkRenderer);
+  AdvanceSimulationFrame(sim);
+}
+
+int main(int argc, char **argv) {
+  // Optional rule string and seed, e.g. "render_test B36/S23 42"; Conway's Life and the clock otherwise.
+  // The seed is logged so a run can be repeated.
+  unsigned int seed = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 0) : (unsigned int)time(NULL);
+  srand(seed);
+  TraceLog(LOG_INFO, "Seed %u", seed);
+  Rule rule = RULE_LIFE;
+  if (argc > 1 && !ParseRule(argv[1], &rule)) {
+    TraceLog(LOG_WARNING, "Ignoring invalid rule '%s'", argv[1]);
+    rule = RULE_LIFE;
+  }
+  SetStepRule(rule);
+  char ruleText[RULE_TEXT_MAX];
+  FormatRule(rule, ruleText);
+
+  Config cfg = { .screenWidth = 800, .screenHeight = 450, .currentMenu = MENU_NONE, .lastMenu = MENU_PAUSE };
   InitWindow(cfg.screenWidth, cfg.screenHeight, "Infinite grid and movement test");
   SetExitKey(KEY_NULL);
 
   Camera2D camera = { 0 };
   camera.zoom = 1.0f;
-  // SetTargetFPS(60);
+  SetTargetFPS(60);
 
   const char *pauseLabels[] = { "Resume", "Settings", "Quit" };
   Menu pauseMenu = CreateMenu(pauseLabels, 3, cfg);
@@ -292,40 +632,64 @@ int main() {
   const char *settingsLabels[] = { "Toggle Lines", "Debug Options", "Return" };
   Menu settingsMenu = CreateMenu(settingsLabels, 3, cfg);
 
-  const char *debugLabels[] = { "Grid Markers", "Debug Text", "Debug Chunk Renderer", "Return" };
-  Menu debugMenu = CreateMenu(debugLabels, 4, cfg);
-
-  Chunk DebugChunk;
-  FillChunk(&DebugChunk);
-  ChunkNode DebugChunkNode = (ChunkNode){
-    .c = DebugChunk, 
-    .Neighbours = NULL, 
-    .x = 0,
-    .y = 0,
-  };
+  const char *debugLabels[] = { "Grid Markers", "Debug Text", "Debug Chunk Renderer", "Profiler", "Return" };
+  Menu debugMenu = CreateMenu(debugLabels, 5, cfg);
+
+  World world;
+  InitWorld(&world, 1024);
+  world.scheduler = CreateScheduler(0);
+  // Resume the previous run if it left a checkpoint behind.
+  if (!LoadWorldSnapshot(&world, CHECKPOINT_PATH)) SeedWorld(&world);
+
+  cfg.simLockstep = true;
+  cfg.simRate = 60;
+  cfg.generationsPerFrame = 1;
+  cfg.jumpLog2 = 10;
+  Profiler profiler;
+  InitProfiler(&profiler);
+  uint64_t lastAllocations = 0;
+  Simulation sim = { .onEmpty = SeedWorld, .checkpointPath = CHECKPOINT_PATH, .checkpointInterval = 30.0,
+                     .profiler = &profiler };
+  SetSimulationLockstep(&sim, cfg.generationsPerFrame);
+  StartSimulation(&sim, &world);
+  CellRenderer cellRenderer;
+  StartCellRenderer(&cellRenderer, &profiler);
+  GridRenderer grid = LoadGridRenderer();
+  SceneCache scene = { 0 };
 
   // Game Loop
   while (!WindowShouldClose()) {
+    BeginProfileFrame(&profiler);
+    double scopeStart = ProfileNow();
     HandleControls(&cfg, &camera);
+    HandleSimulationControls(&cfg, &sim);
+    EndProfileScope(&profiler, PROFILE_INPUT, scopeStart);
+
+    // Last frame's cells are uploaded before this frame's snapshot replaces the one they came from;
+    // the worker then expands the new one while this frame draws.
+    scopeStart = ProfileNow();
+    bool cellsChanged = CollectCells(&cellRenderer, &cfg);
+    EndProfileScope(&profiler, PROFILE_UPLOAD, scopeStart);
+    const Snapshot *snap = AcquireSnapshot(&sim);
+    RecordProfileCounters(&profiler, snap, &lastAllocations);
+    if (cfg.debugChunkRenderer) SubmitCells(&cellRenderer, cfg, camera, snap);
+    else cfg.isChunkOnScreen = false;
+    scopeStart = ProfileNow();
+    if (cellsChanged || IsSceneCacheStale(&scene, camera, cfg)) RenderSceneCache(&scene, &grid, &cellRenderer, camera, cfg);
+    EndProfileScope(&profiler, PROFILE_GRID, scopeStart);
 
     BeginDrawing();
-      ClearBackground(RAYWHITE);
-
       if (cfg.closeApp) { break; }
       /*Always Draw*/ {
-        BeginMode2D(camera); {
-          draw_grid(camera, cfg);
-          if (!cfg.is_paused) 
-            DebugChunkNode.c.chunk_value = 0;
-          if (cfg.debugChunkRenderer) {
-            if (!cfg.is_paused)
-              FillChunk(&DebugChunkNode.c);
-            DrawChunkGridDebug(camera, cfg);
-            DrawChunkNodeDebug(&cfg, camera, DebugChunkNode);
-         } else {
-            cfg.isChunkOnScreen = false;
-          }
-        } EndMode2D();
+        DrawSceneCache(&scene);
+        // Per-chunk corner markers are one draw each, so only with grid markers on and only
+        // while chunks are still larger than a texel.
+        if (cfg.debugChunkRenderer && cfg.debugGrid && cellRenderer.lod == 0) {
+          BeginMode2D(camera);
+            ChunkMarkers markers = { &cfg, camera };
+            DrawVisibleChunks(&markers, snap);
+          EndMode2D();
+        }
 
         if (cfg.debugText) {
           DrawText(TextFormat("Camera Target X: %.2f", camera.target.x), 10, 10, 20, BLACK);
@@ -334,14 +698,27 @@ int main() {
           DrawText(TextFormat("Paused: %s", cfg.is_paused ? "true" : "false"), 10, 100, 20, BLACK);
           DrawText(TextFormat("Debug Chunk Renderer: %s", cfg.debugChunkRenderer ? "on" : "off"), 10, 130, 20, BLACK);
           DrawText(TextFormat("Is Chunk On Screen: %s", cfg.isChunkOnScreen ? "true" : "false"), 10, 160, 20, BLACK);
+          DrawText(TextFormat("Chunks: %u  Generation: %llu", snap->count, (unsigned long long)snap->generation), 10, 190, 20, BLACK);
+          if (cfg.simLockstep)
+            DrawText(TextFormat("Sim: %d gen/frame (%.0f gen/s)", cfg.generationsPerFrame, snap->generationsPerSecond), 10, 220, 20, BLACK);
+          else
+            DrawText(TextFormat("Sim: target %s gen/s (%.0f gen/s)", cfg.simRate ? TextFormat("%d", cfg.simRate) : "unlimited", snap->generationsPerSecond), 10, 220, 20, BLACK);
+          DrawText(TextFormat("HashLife jump (J): %s  Rule: %s%s",
+                              CanHashLifeJump(&sim) ? TextFormat("2^%d generations", cfg.jumpLog2) : "off for Generations rules",
+                              ruleText, IsStepRuleSpecialised() ? "" : " (generic)"), 10, 250, 20, BLACK);
+          DrawText(TextFormat("Chunk pool: %u live, %u peak, %llu recycled, %u pages", snap->pool.live,
+                              snap->pool.peak, (unsigned long long)snap->pool.recycled, snap->pool.pages), 10, 280, 20, BLACK);
         }
 
+        if (cfg.profilerOverlay) DrawProfilerOverlay(&profiler, cfg);
+
         if (cfg.isChunkOnScreen) {
           DrawRectangle(0, 0, cfg.screenWidth, cfg.screenHeight, Fade(MAROON, 0.5f));
         }
       }
 
       // Draw exclusively to the pause menu
+      scopeStart = ProfileNow();
       if (cfg.is_paused) {
         DrawRectangle(0, 0, cfg.screenWidth, cfg.screenHeight, Fade(BLACK, 0.6f));
         int clicked = -1;
@@ -364,18 +741,27 @@ int main() {
               case 0: cfg.debugGrid = !cfg.debugGrid; break;
               case 1: cfg.debugText = !cfg.debugText; break;
               case 2: cfg.debugChunkRenderer = !cfg.debugChunkRenderer; break;
-              case 3: cfg.currentMenu = MENU_SETTINGS; break;
+              case 3: SetProfilerOverlay(&cfg, &profiler, !cfg.profilerOverlay); break;
+              case 4: cfg.currentMenu = MENU_SETTINGS; break;
             } break;
           default:
             break;
         }
       }
+      EndProfileScope(&profiler, PROFILE_MENU, scopeStart);
       // Draw exclusively during gameplay
       // I personally don't see a use case for this
       // if (!cfg.is_paused){}
     EndDrawing();
     DrawFPS(cfg.screenWidth - 100, cfg.screenHeight - 20);
   }
+  UnloadSceneCache(&scene);
+  UnloadCellRenderer(&cellRenderer);
+  UnloadGridRenderer(&grid);
+  StopSimulation(&sim);
+  FreeProfiler(&profiler);
+  DestroyScheduler(world.scheduler);
+  FreeWorld(&world);
   CloseWindow();
   return 0;
 }
@@ -0,0 +1,262 @@
+#include "patternio.h"
+#include "period.h"
+#include "world.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Headless, deterministic replay: seeds a world from a fixed seed or a pattern file, steps it with
+// no window, and prints one JSON object per checkpoint on stdout:
+//
+//   {"generation":100,"hash":"0x...","population":1234,"chunks":56}
+//
+// followed by a summary with the final hash and the wall time. The hash (HashWorld) only depends
+// on the cells, so a run reproduces exactly across thread counts and step kernels; comparing it
+// against a known value catches kernel bugs, and the timings can be collected like Bench output.
+//
+//   Replay [--seed S] [--size N] [--pattern file.rle|file.mc] [--rule B3/S23] [--gens N] [--every N]
+//          [--threads N] [--kernel scalar|avx2|avx512] [--expect HASH] [--census]
+//
+// Without --pattern, a size x size square (rounded up to whole chunks) is filled with random cells
+// from --seed. A pattern file's own rule is used unless --rule is given. --expect exits with 1 when
+// the final hash differs.
+//
+// --census attaches a PeriodTracker (two-state rules only). The hashes stay the same, and the
+// summary gains the tracker's counters followed by one line per object shape it recognised. Shapes
+// repeat on the chunk grid, so a spaceship's period is the one that moves it whole chunks; dx and dy
+// are in cells. A glider:
+//
+//   {"kind":"spaceship","period":32,"dx":8,"dy":8,"population":5,"shapes":9,"detections":12}
+
+typedef struct ReplayConfig {
+  uint64_t seed;
+  int size;
+  const char *pattern;
+  int generations;
+  int every;
+  bool hasExpected;
+  uint64_t expected;
+  bool census;
+} ReplayConfig;
+
+static uint64_t SplitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void AddMoverPopulation(void *ctx, int x, int y, uint64_t value) {
+  (void)x;
+  (void)y;
+  *(uint64_t *)ctx += __builtin_popcountll(value);
+}
+
+static uint64_t WorldPopulation(const World *w) {
+  uint64_t population = 0;
+  for (uint32_t i = 0; i < w->count; i++) population += __builtin_popcountll(w->nodes[i]->c.chunk_value);
+  if (w->periods) VisitPeriodMovers(w->periods, w->generation, AddMoverPopulation, &population);
+  return population;
+}
+
+static void SeedRandom(World *w, int size, uint64_t seed) {
+  uint64_t rng = seed;
+  int chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  for (int y = 0; y < chunks; y++)
+    for (int x = 0; x < chunks; x++) SetChunkValue(w, x, y, SplitMix64(&rng));
+}
+
+static bool ReadPatternFile(World *w, const char *path, PatternInfo *info) {
+  FILE *in = fopen(path, "rb");
+  if (!in) return false;
+  size_t length = strlen(path);
+  bool macrocell = length > 3 && strcmp(path + length - 3, ".mc") == 0;
+  bool ok = (macrocell ? ReadMacrocell : ReadRLE)(w, in, 0, 0, info);
+  fclose(in);
+  return ok;
+}
+
+// The node layout depends on the rule, so a file naming a different rule is read again after
+// switching to it.
+static bool LoadPattern(World *w, const char *path, bool useFileRule) {
+  PatternInfo info;
+  if (!ReadPatternFile(w, path, &info)) return false;
+  Rule rule;
+  if (!useFileRule || !info.rule[0] || !ParseRule(info.rule, &rule) || RulesEqual(rule, GetStepRule())) return true;
+  Scheduler *scheduler = w->scheduler;
+  FreeWorld(w);
+  SetStepRule(rule);
+  InitWorld(w, 1024);
+  w->scheduler = scheduler;
+  return ReadPatternFile(w, path, NULL);
+}
+
+static void PrintCheckpoint(const World *w) {
+  printf("{\"generation\":%llu,\"hash\":\"0x%016llx\",\"population\":%llu,\"chunks\":%u}\n",
+         (unsigned long long)w->generation, (unsigned long long)HashWorld(w),
+         (unsigned long long)WorldPopulation(w), w->count);
+}
+
+static bool IsSameObject(const PeriodShape *a, const PeriodShape *b) {
+  return a->period == b->period && a->dx == b->dx && a->dy == b->dy && a->population == b->population;
+}
+
+static void PrintCensus(const PeriodTracker *t) {
+  const PeriodStats *s = &t->stats;
+  printf("{\"samples\":%llu,\"verified\":%llu,\"oscillators\":%llu,\"spaceships\":%llu,\"woken\":%llu,"
+         "\"landed\":%llu,\"cycled_chunks\":%llu,\"live_oscillators\":%u,\"live_movers\":%u}\n",
+         (unsigned long long)s->samples, (unsigned long long)s->verified, (unsigned long long)s->oscillators,
+         (unsigned long long)s->spaceships, (unsigned long long)s->woken, (unsigned long long)s->landed,
+         (unsigned long long)s->cycledChunks, t->oscillatorCount, t->moverCount);
+  // An object has a shape per alignment to the chunk grid, so equal period, motion and population
+  // are reported together.
+  for (uint32_t i = 0; i < t->shapeCount; i++) {
+    const PeriodShape *shape = &t->shapes[i];
+    bool reported = false;
+    for (uint32_t j = 0; j < i && !reported; j++) reported = IsSameObject(shape, &t->shapes[j]);
+    if (reported) continue;
+    uint32_t shapes = 0;
+    uint64_t detections = 0;
+    for (uint32_t j = i; j < t->shapeCount; j++) {
+      if (!IsSameObject(shape, &t->shapes[j])) continue;
+      shapes++;
+      detections += t->shapes[j].detections;
+    }
+    printf("{\"kind\":\"%s\",\"period\":%u,\"dx\":%d,\"dy\":%d,\"population\":%u,\"shapes\":%u,"
+           "\"detections\":%llu}\n",
+           shape->dx || shape->dy ? "spaceship" : "oscillator", shape->period, shape->dx * CHUNK_SIZE,
+           shape->dy * CHUNK_SIZE, shape->population, shapes, (unsigned long long)detections);
+  }
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [--seed S] [--size N] [--pattern file.rle|file.mc] [--rule B3/S23] [--gens N] [--every N]\n"
+                  "          [--threads N] [--kernel scalar|avx2|avx512] [--expect HASH] [--census]\n", name);
+}
+
+int main(int argc, char **argv) {
+  ReplayConfig cfg = { .seed = 1, .size = 256, .generations = 1000, .every = 100 };
+  bool ruleGiven = false;
+  int threads = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--seed") == 0 && value) {
+      cfg.seed = strtoull(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      cfg.size = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--pattern") == 0 && value) {
+      cfg.pattern = value;
+      i++;
+    } else if (strcmp(arg, "--gens") == 0 && value) {
+      cfg.generations = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--every") == 0 && value) {
+      cfg.every = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      threads = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--kernel") == 0 && value) {
+      int k = 0;
+      while (k < STEP_KERNEL_COUNT && strcmp(value, GetStepKernelName((StepKernel)k)) != 0) k++;
+      if (!SetStepKernel((StepKernel)k)) {
+        fprintf(stderr, "step kernel '%s' is not supported on this CPU\n", value);
+        return 1;
+      }
+      i++;
+    } else if (strcmp(arg, "--rule") == 0 && value) {
+      Rule rule;
+      if (!ParseRule(value, &rule)) {
+        fprintf(stderr, "invalid rule '%s' (B0 rules are not supported)\n", value);
+        return 1;
+      }
+      SetStepRule(rule);
+      ruleGiven = true;
+      i++;
+    } else if (strcmp(arg, "--expect") == 0 && value) {
+      cfg.expected = strtoull(value, NULL, 16);
+      cfg.hasExpected = true;
+      i++;
+    } else if (strcmp(arg, "--census") == 0) {
+      cfg.census = true;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (cfg.generations < 0 || cfg.every <= 0 || cfg.size <= 0) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  double wallStart = NowSeconds();
+  World world;
+  InitWorld(&world, 1024);
+  world.scheduler = threads == 1 ? NULL : CreateScheduler(threads);
+  if (cfg.pattern) {
+    if (!LoadPattern(&world, cfg.pattern, !ruleGiven)) {
+      fprintf(stderr, "cannot read pattern '%s'\n", cfg.pattern);
+      DestroyScheduler(world.scheduler);
+      FreeWorld(&world);
+      return 1;
+    }
+  } else {
+    SeedRandom(&world, cfg.size, cfg.seed);
+  }
+  // After loading, since the pattern may have changed the rule.
+  PeriodTracker periods;
+  if (cfg.census) {
+    if (!InitPeriodTracker(&periods)) {
+      fprintf(stderr, "--census only supports two-state rules\n");
+      DestroyScheduler(world.scheduler);
+      FreeWorld(&world);
+      return 1;
+    }
+    world.periods = &periods;
+  }
+
+  // Only StepWorld is timed; hashing at the checkpoints is not.
+  double stepSeconds = 0;
+  PrintCheckpoint(&world);
+  for (int gen = 1; gen <= cfg.generations; gen++) {
+    double t = NowSeconds();
+    StepWorld(&world);
+    stepSeconds += NowSeconds() - t;
+    if (gen % cfg.every == 0 || gen == cfg.generations) PrintCheckpoint(&world);
+  }
+
+  uint64_t hash = HashWorld(&world);
+  char rule[RULE_TEXT_MAX];
+  FormatRule(GetStepRule(), rule);
+  printf("{\"source\":\"%s\",\"seed\":%llu,\"size\":%d,\"rule\":\"%s\",\"kernel\":\"%s\",\"threads\":%d,"
+         "\"generations\":%d,\"hash\":\"0x%016llx\",\"step_seconds\":%.6f,\"wall_seconds\":%.6f,"
+         "\"gens_per_sec\":%.1f}\n",
+         cfg.pattern ? cfg.pattern : "random", (unsigned long long)cfg.seed, cfg.size, rule,
+         GetStepKernelName(GetStepKernel()), GetSchedulerThreadCount(world.scheduler), cfg.generations,
+         (unsigned long long)hash, stepSeconds, NowSeconds() - wallStart,
+         stepSeconds > 0 ? cfg.generations / stepSeconds : 0.0);
+  if (cfg.census) PrintCensus(&periods);
+
+  DestroyScheduler(world.scheduler);
+  FreeWorld(&world);
+  if (cfg.census) FreePeriodTracker(&periods);
+  if (cfg.hasExpected && hash != cfg.expected) {
+    fprintf(stderr, "hash 0x%016llx does not match the expected 0x%016llx\n", (unsigned long long)hash,
+            (unsigned long long)cfg.expected);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "rule.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Reads neighbour-count digits into *mask and returns the first character after them.
+static const char *ParseCounts(const char *p, uint16_t *mask, bool *ok) {
+  for (; *p >= '0' && *p <= '9'; p++) {
+    if (*p == '9') *ok = false;
+    else *mask |= (uint16_t)(1u << (*p - '0'));
+  }
+  return p;
+}
+
+// Reads an optional "/C<n>" or "/<n>" state count.
+static const char *ParseStates(const char *p, uint16_t *states, bool *ok) {
+  if (*p != '/') return p;
+  p++;
+  if (*p == 'C' || *p == 'c') p++;
+  char *end;
+  long n = strtol(p, &end, 10);
+  if (end == p || n < 2 || n > RULE_MAX_STATES) *ok = false;
+  else *states = (uint16_t)n;
+  return end;
+}
+
+bool ParseRule(const char *text, Rule *rule) {
+  Rule parsed = { .states = 2 };
+  bool ok = true, seenBirth = false, seenSurvive = false;
+  const char *p = text;
+  while (isspace((unsigned char)*p)) p++;
+
+  if (isdigit((unsigned char)*p) || *p == '/') {
+    p = ParseCounts(p, &parsed.survive, &ok);
+    if (*p++ != '/') return false;
+    p = ParseCounts(p, &parsed.birth, &ok);
+    p = ParseStates(p, &parsed.states, &ok);
+  } else {
+    while (ok && (*p == 'B' || *p == 'b' || *p == 'S' || *p == 's')) {
+      bool birth = *p == 'B' || *p == 'b';
+      if (birth ? seenBirth : seenSurvive) return false;
+      if (birth) seenBirth = true;
+      else seenSurvive = true;
+      p = ParseCounts(p + 1, birth ? &parsed.birth : &parsed.survive, &ok);
+      if (*p == '/' && (p[1] == 'B' || p[1] == 'b' || p[1] == 'S' || p[1] == 's')) p++;
+    }
+    ok = ok && seenBirth && seenSurvive;
+    p = ParseStates(p, &parsed.states, &ok);
+  }
+
+  while (isspace((unsigned char)*p)) p++;
+  if (!ok || *p != '\0' || (parsed.birth & 1)) return false;
+  *rule = parsed;
+  return true;
+}
+
+void FormatRule(Rule rule, char *text) {
+  char *p = text;
+  *p++ = 'B';
+  for (int k = 0; k <= 8; k++)
+    if (rule.birth & (1u << k)) *p++ = (char)('0' + k);
+  *p++ = '/';
+  *p++ = 'S';
+  for (int k = 0; k <= 8; k++)
+    if (rule.survive & (1u << k)) *p++ = (char)('0' + k);
+  *p = '\0';
+  if (rule.states > 2) snprintf(p, RULE_TEXT_MAX - (size_t)(p - text), "/C%d", rule.states);
+}
+
+bool RulesEqual(Rule a, Rule b) {
+  return a.birth == b.birth && a.survive == b.survive && a.states == b.states;
+}
+
+int GetRuleDyingPlanes(Rule rule) {
+  int planes = 0;
+  while (rule.states > 2 && (1 << planes) < rule.states - 1) planes++;
+  return planes;
+}
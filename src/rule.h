@@ -0,0 +1,34 @@
+#ifndef RULE_H
+#define RULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Outer-totalistic rule: bit k of birth (survive) is set when a dead (live) cell with k live
+// neighbours is alive next generation.
+//
+// With more than two states it is a Generations rule: a live cell that does not survive starts
+// dying and passes through states 2 .. states-1, one per generation, before it is dead again.
+// Dying cells neither count as neighbours nor can be born.
+typedef struct Rule {
+  uint16_t birth;
+  uint16_t survive;
+  uint16_t states;
+} Rule;
+
+#define RULE_LIFE ((Rule){ 1 << 3, (1 << 2) | (1 << 3), 2 })
+#define RULE_MAX_STATES 256
+#define RULE_TEXT_MAX 32
+
+// Accepts "B3/S23", "b36/s23", "S23/B3", "B2/S" and the older "23/3" (survive/birth) form, and
+// Generations rules as "B2/S/C3", "B2/S/3" or "/2/3" (survive/birth/states).
+// Rules with B0 are rejected: they turn empty space on, which a sparse world cannot represent.
+bool ParseRule(const char *text, Rule *rule);
+// Writes the canonical "B.../S..." (or "B.../S.../C...") form; text must hold RULE_TEXT_MAX bytes.
+void FormatRule(Rule rule, char *text);
+bool RulesEqual(Rule a, Rule b);
+// Bit-planes needed to store the dying states 2 .. states-1; 0 for two-state rules.
+int GetRuleDyingPlanes(Rule rule);
+
+#endif
@@ -0,0 +1,151 @@
+#include "scheduler.h"
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64
+
+// One per worker, padded so cursors bumped by different threads never share a line.
+typedef struct WorkQueue {
+  alignas(CACHE_LINE) atomic_uint next;
+  uint32_t end;
+} WorkQueue;
+
+typedef struct Worker {
+  Scheduler *scheduler;
+  int id;
+} Worker;
+
+struct Scheduler {
+  WorkQueue *queues;
+  Worker *workers;
+  pthread_t *threads;
+  int threadCount;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  uint64_t epoch;
+  int pending;
+  bool quit;
+
+  TaskFn fn;
+  void *ctx;
+  uint32_t batch;
+};
+
+static void RunWorker(Scheduler *s, int id) {
+  // Drain our own range first, then walk the others and steal what is left of them.
+  for (int k = 0; k < s->threadCount; k++) {
+    WorkQueue *q = &s->queues[(id + k) % s->threadCount];
+    for (;;) {
+      uint32_t begin = atomic_fetch_add_explicit(&q->next, s->batch, memory_order_relaxed);
+      if (begin >= q->end) break;
+      uint32_t end = q->end - begin > s->batch ? begin + s->batch : q->end;
+      s->fn(s->ctx, begin, end);
+    }
+  }
+}
+
+static void *WorkerMain(void *arg) {
+  Worker *worker = arg;
+  Scheduler *s = worker->scheduler;
+  uint64_t seen = 0;
+
+  pthread_mutex_lock(&s->lock);
+  for (;;) {
+    while (s->epoch == seen && !s->quit) pthread_cond_wait(&s->wake, &s->lock);
+    if (s->quit) break;
+    seen = s->epoch;
+    pthread_mutex_unlock(&s->lock);
+
+    RunWorker(s, worker->id);
+
+    pthread_mutex_lock(&s->lock);
+    if (--s->pending == 0) pthread_cond_signal(&s->done);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+Scheduler *CreateScheduler(int threadCount) {
+  if (threadCount <= 0) threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threadCount <= 0) threadCount = 1;
+
+  Scheduler *s = calloc(1, sizeof(Scheduler));
+  s->threadCount = threadCount;
+  s->queues = aligned_alloc(CACHE_LINE, threadCount * sizeof(WorkQueue));
+  s->workers = calloc(threadCount, sizeof(Worker));
+  s->threads = calloc(threadCount, sizeof(pthread_t));
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->wake, NULL);
+  pthread_cond_init(&s->done, NULL);
+
+  for (int i = 0; i < threadCount; i++) {
+    atomic_init(&s->queues[i].next, 0);
+    s->queues[i].end = 0;
+    s->workers[i] = (Worker){ s, i };
+    if (i > 0) pthread_create(&s->threads[i], NULL, WorkerMain, &s->workers[i]);
+  }
+  return s;
+}
+
+void DestroyScheduler(Scheduler *s) {
+  if (!s) return;
+  pthread_mutex_lock(&s->lock);
+  s->quit = true;
+  pthread_cond_broadcast(&s->wake);
+  pthread_mutex_unlock(&s->lock);
+  for (int i = 1; i < s->threadCount; i++) pthread_join(s->threads[i], NULL);
+
+  pthread_cond_destroy(&s->done);
+  pthread_cond_destroy(&s->wake);
+  pthread_mutex_destroy(&s->lock);
+  free(s->threads);
+  free(s->workers);
+  free(s->queues);
+  free(s);
+}
+
+int GetSchedulerThreadCount(const Scheduler *s) {
+  return s ? s->threadCount : 1;
+}
+
+void RunParallel(Scheduler *s, uint32_t count, uint32_t batch, TaskFn fn, void *ctx) {
+  if (count == 0) return;
+  if (batch == 0) batch = 1;
+  // Waking the pool costs more than a couple of batches of work.
+  if (!s || s->threadCount == 1 || count <= batch * 2) {
+    fn(ctx, 0, count);
+    return;
+  }
+
+  uint32_t share = count / s->threadCount;
+  uint32_t extra = count % s->threadCount;
+  uint32_t begin = 0;
+  for (int i = 0; i < s->threadCount; i++) {
+    uint32_t size = share + ((uint32_t)i < extra ? 1 : 0);
+    atomic_store_explicit(&s->queues[i].next, begin, memory_order_relaxed);
+    s->queues[i].end = begin + size;
+    begin += size;
+  }
+
+  pthread_mutex_lock(&s->lock);
+  s->fn = fn;
+  s->ctx = ctx;
+  s->batch = batch;
+  s->pending = s->threadCount - 1;
+  s->epoch++;
+  pthread_cond_broadcast(&s->wake);
+  pthread_mutex_unlock(&s->lock);
+
+  RunWorker(s, 0);
+
+  pthread_mutex_lock(&s->lock);
+  while (s->pending > 0) pthread_cond_wait(&s->done, &s->lock);
+  pthread_mutex_unlock(&s->lock);
+}
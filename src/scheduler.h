@@ -0,0 +1,22 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Fork-join pool for data-parallel loops over [0, count). Each worker owns a contiguous range and
+// claims batches from it; a worker that runs dry steals batches from the other ranges. The calling
+// thread takes part as worker 0, and workers only block between RunParallel calls.
+typedef struct Scheduler Scheduler;
+
+typedef void (*TaskFn)(void *ctx, uint32_t begin, uint32_t end);
+
+// threadCount <= 0 uses every online core.
+Scheduler *CreateScheduler(int threadCount);
+void DestroyScheduler(Scheduler *s);
+int GetSchedulerThreadCount(const Scheduler *s);
+
+// Calls fn over [0, count) in batches of at most `batch` items and returns once all are done.
+// A NULL scheduler runs the whole range on the calling thread.
+void RunParallel(Scheduler *s, uint32_t count, uint32_t batch, TaskFn fn, void *ctx);
+
+#endif
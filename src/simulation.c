@@ -0,0 +1,448 @@
+#include "simulation.h"
+#include "period.h"
+#include "snapshot.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void SleepSeconds(double seconds) {
+  struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+  nanosleep(&ts, NULL);
+}
+
+typedef struct SnapshotSortEntry {
+  uint64_t key;
+  uint64_t index;
+} SnapshotSortEntry;
+
+#define SORT_DIGIT_BITS 11
+
+// LSD radix sort of (key, index) entries, skipping digits every key shares (chunk coordinates
+// rarely span more than a couple of digits of the curve), then one gather of the chunks. Worlds
+// that barely moved since the last capture are often still in order and skip the sort entirely.
+static void SortSnapshot(Snapshot *snap) {
+  uint64_t differ = 0;
+  bool sorted = true;
+  for (uint32_t i = 1; i < snap->count; i++) {
+    differ |= snap->keys[i] ^ snap->keys[0];
+    sorted = sorted && snap->keys[i - 1] < snap->keys[i];
+  }
+  if (sorted) return;
+
+  SnapshotSortEntry *from = snap->sortEntries, *to = snap->sortEntries + snap->capacity;
+  for (uint32_t i = 0; i < snap->count; i++) from[i] = (SnapshotSortEntry){ snap->keys[i], i };
+  for (int shift = 0; shift < 64; shift += SORT_DIGIT_BITS) {
+    uint64_t digit = (1u << SORT_DIGIT_BITS) - 1;
+    if (!((differ >> shift) & digit)) continue;
+    uint32_t offsets[1 << SORT_DIGIT_BITS] = { 0 };
+    for (uint32_t i = 0; i < snap->count; i++) offsets[(from[i].key >> shift) & digit]++;
+    for (uint32_t b = 0, sum = 0; b <= digit; b++) {
+      uint32_t n = offsets[b];
+      offsets[b] = sum;
+      sum += n;
+    }
+    for (uint32_t i = 0; i < snap->count; i++) to[offsets[(from[i].key >> shift) & digit]++] = from[i];
+    SnapshotSortEntry *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  for (uint32_t i = 0; i < snap->count; i++) {
+    snap->keys[i] = from[i].key;
+    snap->sortChunks[i] = snap->chunks[from[i].index];
+  }
+  SnapshotChunk *chunks = snap->chunks;
+  snap->chunks = snap->sortChunks;
+  snap->sortChunks = chunks;
+}
+
+static void CountMoverChunk(void *ctx, int x, int y, uint64_t value) {
+  (void)x;
+  (void)y;
+  (void)value;
+  (*(uint32_t *)ctx)++;
+}
+
+static void AddMoverChunk(void *ctx, int x, int y, uint64_t value) {
+  Snapshot *snap = ctx;
+  snap->keys[snap->count] = MortonKey(x, y);
+  snap->chunks[snap->count++] = (SnapshotChunk){ x, y, value, 0 };
+}
+
+static void CaptureSnapshot(Snapshot *snap, const World *w, float rate, float stepMilliseconds) {
+  uint32_t count = w->count;
+  if (w->periods) VisitPeriodMovers(w->periods, w->generation, CountMoverChunk, &count);
+  if (snap->capacity < count) {
+    snap->capacity = count + count / 2;
+    snap->chunks = realloc(snap->chunks, snap->capacity * sizeof(SnapshotChunk));
+    snap->sortChunks = realloc(snap->sortChunks, snap->capacity * sizeof(SnapshotChunk));
+    snap->keys = realloc(snap->keys, snap->capacity * sizeof(uint64_t));
+    snap->sortEntries = realloc(snap->sortEntries, 2 * snap->capacity * sizeof(SnapshotSortEntry));
+    snap->populationBefore = realloc(snap->populationBefore, (snap->capacity + 1) * sizeof(uint64_t));
+  }
+  if (!snap->populationBefore) snap->populationBefore = malloc(sizeof(uint64_t));
+  snap->count = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    uint64_t dying = GetDyingCells(w, node);
+    if (!node->c.chunk_value && !dying) continue;
+    snap->keys[snap->count] = MortonKey(node->x, node->y);
+    snap->chunks[snap->count++] = (SnapshotChunk){ node->x, node->y, node->c.chunk_value, dying };
+  }
+  if (w->periods) VisitPeriodMovers(w->periods, w->generation, AddMoverChunk, snap);
+  SortSnapshot(snap);
+  snap->populationBefore[0] = 0;
+  for (uint32_t i = 0; i < snap->count; i++)
+    snap->populationBefore[i + 1] = snap->populationBefore[i] + __builtin_popcountll(snap->chunks[i].value);
+  snap->population = snap->populationBefore[snap->count];
+  snap->generation = w->generation;
+  snap->generationsPerSecond = rate;
+  snap->stepMilliseconds = stepMilliseconds;
+  snap->activeChunks = w->active.count;
+  snap->pool = w->pool.stats;
+}
+
+static void PublishSnapshot(TripleBuffer *tb) {
+  tb->back = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel) & 3u;
+}
+
+static void RunHashLifeJump(Simulation *sim, int k) {
+  if (sim->world->planes) return;
+  if (sim->world->periods) RestorePeriodObjects(sim->world);
+  if (!sim->hashlifeReady) {
+    InitHashLife(&sim->hashlife, SIM_HASHLIFE_MEMORY);
+    sim->hashlifeReady = true;
+  }
+  LoadHashLifeFromWorld(&sim->hashlife, sim->world);
+  JumpHashLife(&sim->hashlife, k);
+  ClearWorld(sim->world);
+  StoreHashLifeToWorld(&sim->hashlife, sim->world);
+}
+
+static void TraceSimulation(Simulation *sim, ProfileScope scope, double start) {
+  if (sim->profiler) TraceProfileScope(sim->profiler, scope, PROFILE_THREAD_SIMULATION, start, NowSeconds());
+}
+
+// Encodes the current generation into the next free slot for the writer thread. Returns false,
+// with the world untouched, while every slot is still waiting to be written, unless wait is set.
+static bool QueueCheckpoint(Simulation *sim, bool wait) {
+  CheckpointQueue *q = &sim->checkpoints;
+  pthread_mutex_lock(&q->lock);
+  while (wait && q->count == SIM_CHECKPOINT_QUEUE) pthread_cond_wait(&q->written, &q->lock);
+  bool room = q->count < SIM_CHECKPOINT_QUEUE;
+  CheckpointBuffer *buffer = &q->buffers[(q->head + q->count) % SIM_CHECKPOINT_QUEUE];
+  // The file no longer holds what later deltas build on.
+  if (q->failed) sim->world->needsFullSave = true;
+  q->failed = false;
+  pthread_mutex_unlock(&q->lock);
+  if (!room) return false;
+
+  // Only this thread fills free slots, so the buffer is safe to encode into without the lock.
+  if (sim->world->periods) RestorePeriodObjects(sim->world);
+  EncodeWorldCheckpoint(sim->world, sim->checkpointDeltas >= SIM_CHECKPOINT_COMPACT_EVERY, buffer);
+  sim->checkpointDeltas = buffer->full ? 0 : sim->checkpointDeltas + 1;
+  pthread_mutex_lock(&q->lock);
+  q->count++;
+  pthread_cond_signal(&q->queued);
+  pthread_mutex_unlock(&q->lock);
+  return true;
+}
+
+static void *CheckpointWriterMain(void *arg) {
+  Simulation *sim = arg;
+  CheckpointQueue *q = &sim->checkpoints;
+  bool broken = false; // A write failed and no full checkpoint has replaced the file since
+  pthread_mutex_lock(&q->lock);
+  for (;;) {
+    while (!q->count && !q->quit) pthread_cond_wait(&q->queued, &q->lock);
+    if (!q->count) break;
+    const CheckpointBuffer *buffer = &q->buffers[q->head];
+    pthread_mutex_unlock(&q->lock);
+
+    // Deltas queued before the simulation thread heard of a failure cannot apply to the file.
+    double start = NowSeconds();
+    bool skip = broken && !buffer->full;
+    bool ok = !skip && WriteWorldCheckpoint(buffer, sim->checkpointPath);
+    if (!skip) broken = !ok;
+    if (sim->profiler) TraceProfileScope(sim->profiler, PROFILE_CHECKPOINT, PROFILE_THREAD_CHECKPOINT, start, NowSeconds());
+
+    pthread_mutex_lock(&q->lock);
+    if (!skip && !ok) q->failed = true;
+    q->head = (q->head + 1) % SIM_CHECKPOINT_QUEUE;
+    q->count--;
+    pthread_cond_signal(&q->written);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return NULL;
+}
+
+static void *SimulationMain(void *arg) {
+  Simulation *sim = arg;
+  TripleBuffer *tb = &sim->snapshots;
+  double rateStart = NowSeconds();
+  uint64_t rateGenerations = 0;
+  double paceStart = rateStart;
+  uint64_t paceGenerations = 0;
+  int paceRate = -1;
+  float measuredRate = 0.0f;
+  float stepMilliseconds = 0.0f;
+  double lastCheckpoint = rateStart;
+  uint64_t checkpointGeneration = sim->world->generation;
+  // StartSimulation published this generation already, with a rate of 0 as if paused.
+  uint64_t capturedGeneration = sim->world->generation;
+  bool capturedPaused = true;
+
+  while (!atomic_load(&sim->quit)) {
+    double now = NowSeconds();
+    int mode = atomic_load(&sim->mode);
+    int rate = atomic_load(&sim->targetRate);
+    bool paused = atomic_load(&sim->paused);
+
+    int jump = atomic_exchange(&sim->jumpRequest, -1);
+    if (jump >= 0) {
+      RunHashLifeJump(sim, jump);
+      TraceSimulation(sim, PROFILE_HASHLIFE, now);
+    }
+
+    // Work out how many generations are due now.
+    int due = 0;
+    if (!paused && mode == SIM_LOCKSTEP) {
+      due = atomic_exchange(&sim->grantedGenerations, 0);
+    } else if (!paused && rate == 0) {
+      due = 1;
+    } else if (!paused) {
+      if (rate != paceRate) {
+        paceRate = rate;
+        paceStart = now;
+        paceGenerations = 0;
+      }
+      uint64_t target = (uint64_t)((now - paceStart) * rate);
+      // After a stall, drop the backlog rather than sprinting to catch up.
+      if (target > paceGenerations + (uint64_t)rate / 10 + 1) {
+        paceStart = now - (double)paceGenerations / rate;
+        target = paceGenerations + 1;
+      }
+      due = (int)(target - paceGenerations);
+    }
+    if (paused || mode == SIM_LOCKSTEP) paceRate = -1;
+
+    double stepStart = NowSeconds();
+    for (int i = 0; i < due; i++) {
+      StepWorld(sim->world);
+      if (sim->world->count == 0 && sim->onEmpty) sim->onEmpty(sim->world);
+    }
+    if (due > 0) {
+      stepMilliseconds = (float)((NowSeconds() - stepStart) * 1e3 / due);
+      TraceSimulation(sim, PROFILE_SIM_STEP, stepStart);
+    }
+    paceGenerations += due;
+    rateGenerations += due;
+
+    bool requested = atomic_exchange(&sim->checkpointRequest, false);
+    bool periodic = sim->checkpointInterval > 0 && now - lastCheckpoint >= sim->checkpointInterval &&
+                    sim->world->generation != checkpointGeneration;
+    if (sim->checkpointPath && (requested || periodic)) {
+      double checkpointStart = NowSeconds();
+      if (QueueCheckpoint(sim, false)) {
+        TraceSimulation(sim, PROFILE_CHECKPOINT, checkpointStart);
+        lastCheckpoint = now;
+        checkpointGeneration = sim->world->generation;
+      } else if (requested) {
+        atomic_store(&sim->checkpointRequest, true);
+      }
+    }
+
+    if (now - rateStart >= 0.5) {
+      measuredRate = (float)(rateGenerations / (now - rateStart));
+      rateStart = now;
+      rateGenerations = 0;
+    }
+
+    // Only copy the world out once the renderer has taken the previous snapshot, and only if it
+    // changed: the world only changes by stepping, so a still world costs neither side anything.
+    bool stale = sim->world->generation != capturedGeneration || paused != capturedPaused;
+    if (stale && !(atomic_load_explicit(&tb->middle, memory_order_acquire) & TRIPLE_BUFFER_FRESH)) {
+      double captureStart = NowSeconds();
+      CaptureSnapshot(&tb->buffers[tb->back], sim->world, paused ? 0.0f : measuredRate, stepMilliseconds);
+      PublishSnapshot(tb);
+      capturedGeneration = sim->world->generation;
+      capturedPaused = paused;
+      TraceSimulation(sim, PROFILE_SNAPSHOT, captureStart);
+    }
+
+    if (due == 0) {
+      double idle = 0.001;
+      if (!paused && mode == SIM_FREE_RUNNING && rate > 0 && 0.5 / rate < idle) idle = 0.5 / rate;
+      SleepSeconds(idle);
+    }
+  }
+  return NULL;
+}
+
+void StartSimulation(Simulation *sim, World *world) {
+  sim->world = world;
+  sim->snapshots = (TripleBuffer){ .back = 0, .front = 1 };
+  atomic_init(&sim->snapshots.middle, 2);
+  CaptureSnapshot(&sim->snapshots.buffers[1], world, 0.0f, 0.0f);
+  atomic_init(&sim->quit, false);
+  atomic_init(&sim->jumpRequest, -1);
+  atomic_init(&sim->checkpointRequest, false);
+  if (sim->checkpointPath) {
+    CheckpointQueue *q = &sim->checkpoints;
+    *q = (CheckpointQueue){ 0 };
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->queued, NULL);
+    pthread_cond_init(&q->written, NULL);
+    pthread_create(&q->thread, NULL, CheckpointWriterMain, sim);
+  }
+  pthread_create(&sim->thread, NULL, SimulationMain, sim);
+}
+
+void StopSimulation(Simulation *sim) {
+  atomic_store(&sim->quit, true);
+  pthread_join(sim->thread, NULL);
+  if (sim->checkpointPath) {
+    CheckpointQueue *q = &sim->checkpoints;
+    QueueCheckpoint(sim, true);
+    pthread_mutex_lock(&q->lock);
+    q->quit = true;
+    pthread_cond_signal(&q->queued);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+    for (int i = 0; i < SIM_CHECKPOINT_QUEUE; i++) FreeCheckpointBuffer(&q->buffers[i]);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->queued);
+    pthread_cond_destroy(&q->written);
+  }
+  for (int i = 0; i < 3; i++) {
+    Snapshot *snap = &sim->snapshots.buffers[i];
+    free(snap->chunks);
+    free(snap->keys);
+    free(snap->populationBefore);
+    free(snap->sortChunks);
+    free(snap->sortEntries);
+  }
+  sim->snapshots = (TripleBuffer){ 0 };
+  if (sim->hashlifeReady) FreeHashLife(&sim->hashlife);
+  sim->hashlifeReady = false;
+}
+
+void RequestCheckpoint(Simulation *sim) {
+  atomic_store(&sim->checkpointRequest, true);
+}
+
+void SetSimulationPaused(Simulation *sim, bool paused) {
+  atomic_store(&sim->paused, paused);
+}
+
+void SetSimulationRate(Simulation *sim, int generationsPerSecond) {
+  atomic_store(&sim->targetRate, generationsPerSecond < 0 ? 0 : generationsPerSecond);
+  atomic_store(&sim->mode, SIM_FREE_RUNNING);
+}
+
+void SetSimulationLockstep(Simulation *sim, int generationsPerFrame) {
+  atomic_store(&sim->generationsPerFrame, generationsPerFrame < 1 ? 1 : generationsPerFrame);
+  atomic_store(&sim->grantedGenerations, 0);
+  atomic_store(&sim->mode, SIM_LOCKSTEP);
+}
+
+void AdvanceSimulationFrame(Simulation *sim) {
+  if (atomic_load(&sim->mode) != SIM_LOCKSTEP) return;
+  // Grant at most one frame ahead so a slow sim does not build up an ever-growing backlog.
+  int perFrame = atomic_load(&sim->generationsPerFrame);
+  int granted = atomic_load(&sim->grantedGenerations);
+  if (granted < perFrame) atomic_fetch_add(&sim->grantedGenerations, perFrame);
+}
+
+// The world's plane count is fixed when it is created, so the render thread may read it.
+bool CanHashLifeJump(const Simulation *sim) {
+  return sim->world->planes == 0;
+}
+
+bool RequestHashLifeJump(Simulation *sim, int k) {
+  if (!CanHashLifeJump(sim)) return false;
+  atomic_store(&sim->jumpRequest, k);
+  return true;
+}
+
+const Snapshot *AcquireSnapshot(Simulation *sim) {
+  TripleBuffer *tb = &sim->snapshots;
+  if (atomic_load_explicit(&tb->middle, memory_order_acquire) & TRIPLE_BUFFER_FRESH)
+    tb->front = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel) & 3u;
+  return &tb->buffers[tb->front];
+}
+
+// First index in [begin, end) whose key is at least key.
+static uint32_t LowerBound(const uint64_t *keys, uint32_t begin, uint32_t end, uint64_t key) {
+  while (begin < end) {
+    uint32_t mid = begin + (end - begin) / 2;
+    if (keys[mid] < key) begin = mid + 1;
+    else end = mid;
+  }
+  return begin;
+}
+
+typedef struct SnapshotQuery {
+  const Snapshot *snap;
+  uint32_t x0, y0, x1, y1; // Biased like MortonKey, so unsigned order matches signed order
+  int level;
+  SnapshotVisitFn visit;
+  void *ctx;
+} SnapshotQuery;
+
+static void VisitSquare(const SnapshotQuery *q, uint32_t x, uint32_t y, uint32_t begin, uint32_t end) {
+  const Snapshot *snap = q->snap;
+  q->visit(q->ctx, (int)(x ^ 0x80000000u), (int)(y ^ 0x80000000u), snap->chunks + begin, end - begin,
+           snap->populationBefore[end] - snap->populationBefore[begin]);
+}
+
+// Chunks [begin, end) are exactly those in the square of side 2^size at biased corner (x, y).
+static void QuerySquare(const SnapshotQuery *q, uint32_t x, uint32_t y, int size, uint32_t begin, uint32_t end) {
+  if (begin == end) return;
+  uint32_t span = (uint32_t)(((uint64_t)1 << size) - 1);
+  if (x > q->x1 || y > q->y1 || x + span < q->x0 || y + span < q->y0) return;
+  if (size == q->level) {
+    VisitSquare(q, x, y, begin, end);
+    return;
+  }
+
+  // Inside the view with fewer chunks than target squares: walk the run, grouping by square.
+  int shift = 2 * q->level;
+  bool inside = x >= q->x0 && y >= q->y0 && x + span <= q->x1 && y + span <= q->y1;
+  if (inside && (size - q->level >= 16 || end - begin <= (1u << 2 * (size - q->level)))) {
+    const uint64_t *keys = q->snap->keys;
+    for (uint32_t i = begin, j; i < end; i = j) {
+      for (j = i + 1; j < end && keys[j] >> shift == keys[i] >> shift; j++) {}
+      uint64_t corner = keys[i] >> shift << shift;
+      VisitSquare(q, CompactBits(corner), CompactBits(corner >> 1), i, j);
+    }
+    return;
+  }
+
+  uint32_t half = (uint32_t)1 << (size - 1);
+  uint64_t quarter = (uint64_t)1 << 2 * (size - 1);
+  uint64_t base = SpreadBits(x) | SpreadBits(y) << 1;
+  uint32_t split[5] = { begin, 0, 0, 0, end };
+  for (int k = 1; k < 4; k++) split[k] = LowerBound(q->snap->keys, split[k - 1], end, base + quarter * k);
+  QuerySquare(q, x, y, size - 1, split[0], split[1]);
+  QuerySquare(q, x + half, y, size - 1, split[1], split[2]);
+  QuerySquare(q, x, y + half, size - 1, split[2], split[3]);
+  QuerySquare(q, x + half, y + half, size - 1, split[3], split[4]);
+}
+
+void QuerySnapshot(const Snapshot *snap, int x0, int y0, int x1, int y1, int level, SnapshotVisitFn visit, void *ctx) {
+  if (x0 > x1 || y0 > y1) return;
+  SnapshotQuery q = {
+    snap,
+    (uint32_t)x0 ^ 0x80000000u, (uint32_t)y0 ^ 0x80000000u,
+    (uint32_t)x1 ^ 0x80000000u, (uint32_t)y1 ^ 0x80000000u,
+    level < 0 ? 0 : level > 32 ? 32 : level, visit, ctx,
+  };
+  QuerySquare(&q, 0, 0, 32, 0, snap->count);
+}
@@ -0,0 +1,132 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "hashlife.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "world.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Immutable copy of the live chunks of a world, handed from the simulation thread to the renderer.
+typedef struct SnapshotChunk {
+  int x, y;
+  uint64_t value;
+  uint64_t dying; // Cells in any dying state; always 0 for two-state rules
+} SnapshotChunk;
+
+// Chunks are sorted along the Morton curve, so any aligned square of chunks is a contiguous run
+// and the prefix populations give its live cell count without touching the chunks: the layout
+// doubles as an implicit quadtree for view queries and level-of-detail rendering.
+typedef struct Snapshot {
+  SnapshotChunk *chunks;
+  uint64_t *keys; // MortonKey of each chunk, ascending
+  uint64_t *populationBefore; // count + 1 entries: live cells in chunks[0 .. i)
+  SnapshotChunk *sortChunks; // Scratch for the radix sort
+  struct SnapshotSortEntry *sortEntries;
+  uint32_t count;
+  uint32_t capacity;
+  uint64_t generation;
+  uint64_t population;
+  float generationsPerSecond; // Measured by the simulation thread
+  float stepMilliseconds; // Mean StepWorld time over the last batch of generations
+  uint32_t activeChunks;
+  ChunkPoolStats pool;
+} Snapshot;
+
+// Lock-free single-producer/single-consumer triple buffer. The writer fills `back` and swaps it
+// with `middle`; the reader swaps `front` with `middle` only when a fresh one was published.
+// Neither side ever waits for the other.
+typedef struct TripleBuffer {
+  Snapshot buffers[3];
+  atomic_uint middle; // Buffer index, plus TRIPLE_BUFFER_FRESH once published and not yet taken
+  uint32_t back;
+  uint32_t front;
+} TripleBuffer;
+
+#define TRIPLE_BUFFER_FRESH 4u
+
+// Node cache cap for HashLife jumps run by the simulation thread.
+#define SIM_HASHLIFE_MEMORY ((size_t)256 << 20)
+
+// Every this many incremental checkpoints the file is rewritten as one full snapshot, which bounds
+// both its size and the replay time on load.
+#define SIM_CHECKPOINT_COMPACT_EVERY 64
+
+// Encoded checkpoints waiting for the writer thread. When every slot is taken, a due checkpoint
+// waits until one frees up instead of stalling the simulation on the disk.
+#define SIM_CHECKPOINT_QUEUE 4
+
+// Ring of checkpoints from the simulation thread to the writer thread, which puts them on disk
+// in order while the simulation steps on.
+typedef struct CheckpointQueue {
+  CheckpointBuffer buffers[SIM_CHECKPOINT_QUEUE];
+  uint32_t head, count; // Guarded by lock, like the flags below
+  bool quit; // Write what is queued, then stop
+  bool failed; // A write failed since the simulation thread last looked
+  pthread_mutex_t lock;
+  pthread_cond_t queued;
+  pthread_cond_t written;
+  pthread_t thread;
+} CheckpointQueue;
+
+typedef enum {
+  SIM_FREE_RUNNING, // Paced to targetRate gen/s; 0 means as fast as possible
+  SIM_LOCKSTEP      // Runs generationsPerFrame generations each time the renderer grants a frame
+} SimulationMode;
+
+typedef struct Simulation {
+  World *world;
+  TripleBuffer snapshots;
+  pthread_t thread;
+  void (*onEmpty)(World *w); // Optional; called on the sim thread when the world dies out
+  HashLife hashlife; // Kept across jumps so memoised results are reused
+  bool hashlifeReady;
+  const char *checkpointPath; // Optional; see snapshot.h
+  double checkpointInterval;  // Seconds between automatic checkpoints, 0 for manual only
+  uint32_t checkpointDeltas;
+  CheckpointQueue checkpoints;
+  Profiler *profiler; // Optional; steps, captures, checkpoints and jumps are traced to it
+
+  atomic_bool quit;
+  atomic_bool paused;
+  atomic_int mode;
+  atomic_int targetRate;
+  atomic_int generationsPerFrame;
+  atomic_int grantedGenerations;
+  atomic_int jumpRequest; // log2 of the generations to skip, -1 if none
+  atomic_bool checkpointRequest;
+} Simulation;
+
+// Zero-initialise the Simulation, then set onEmpty, the checkpoint path, the profiler and the rate
+// or lockstep mode before starting. The simulation thread owns the world between StartSimulation and
+// StopSimulation, and writes a last checkpoint on stop. Checkpoints are encoded on the simulation
+// thread and written by a thread of their own, so the file may trail the world by a few of them.
+void StartSimulation(Simulation *sim, World *world);
+void StopSimulation(Simulation *sim);
+void SetSimulationPaused(Simulation *sim, bool paused);
+void SetSimulationRate(Simulation *sim, int generationsPerSecond);
+void SetSimulationLockstep(Simulation *sim, int generationsPerFrame);
+// Call once per rendered frame; only has an effect in SIM_LOCKSTEP mode.
+void AdvanceSimulationFrame(Simulation *sim);
+// Skips 2^k generations with HashLife on the simulation thread, then resumes normal stepping.
+// HashLife only models two-state rules, so under a Generations rule it returns false instead.
+bool RequestHashLifeJump(Simulation *sim, int k);
+bool CanHashLifeJump(const Simulation *sim);
+// Queues a checkpoint of the current generation for checkpointPath; ignored without a path.
+void RequestCheckpoint(Simulation *sim);
+// Latest published snapshot; stays valid until the next call from the same (render) thread.
+const Snapshot *AcquireSnapshot(Simulation *sim);
+
+// Calls visit for every aligned square of 2^level x 2^level chunks that has chunks in the snapshot
+// and overlaps the chunk rectangle [x0, x1] x [y0, y1], in Morton order, with its corner chunk,
+// its chunks and their live cell count. Empty space costs nothing; each square costs O(log n) at
+// worst, or O(1) per chunk where the chunks are sparser than the squares.
+typedef void (*SnapshotVisitFn)(void *ctx, int x, int y, const SnapshotChunk *chunks, uint32_t count,
+                                uint64_t population);
+void QuerySnapshot(const Snapshot *snap, int x0, int y0, int x1, int y1, int level, SnapshotVisitFn visit, void *ctx);
+
+#endif
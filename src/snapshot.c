@@ -0,0 +1,273 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SEGMENT_MAGIC 0x4D474553u // "SEGM"
+
+_Static_assert(sizeof(ChunkCoord) == 8, "snapshot coordinates are two int32 words");
+_Static_assert(sizeof(SnapshotFileHeader) == 16, "snapshot file header layout");
+_Static_assert(sizeof(SnapshotSegmentHeader) == 32, "snapshot segment header layout");
+
+static inline uint64_t MixChecksum(uint64_t h, uint64_t word) {
+  h ^= word;
+  h *= 0x100000001b3ULL;
+  return h ^ (h >> 29);
+}
+
+static uint64_t ChecksumWords(uint64_t h, const void *data, size_t bytes) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < bytes; i += 8) {
+    uint64_t word;
+    memcpy(&word, p + i, 8);
+    h = MixChecksum(h, word);
+  }
+  return h;
+}
+
+// Segments go straight to a file, or to a CheckpointBuffer when file is NULL.
+typedef struct SegmentWriter {
+  FILE *file;
+  CheckpointBuffer *buffer;
+  uint64_t checksum;
+  bool ok;
+} SegmentWriter;
+
+static void WriteBytes(SegmentWriter *sw, const void *data, size_t bytes) {
+  if (!sw->ok) return;
+  if (sw->file) {
+    if (fwrite(data, 1, bytes, sw->file) != bytes) sw->ok = false;
+    return;
+  }
+  CheckpointBuffer *b = sw->buffer;
+  if (b->length + bytes > b->capacity) {
+    while (b->length + bytes > b->capacity) b->capacity = b->capacity ? b->capacity * 2 : 65536;
+    b->data = realloc(b->data, b->capacity);
+  }
+  memcpy(b->data + b->length, data, bytes);
+  b->length += bytes;
+}
+
+static void WriteWords(SegmentWriter *sw, const void *data, size_t bytes) {
+  if (bytes == 0) return;
+  sw->checksum = ChecksumWords(sw->checksum, data, bytes);
+  WriteBytes(sw, data, bytes);
+}
+
+static bool IsChunkStored(const World *w, const ChunkNode *node, bool full) {
+  if (full) return node->c.chunk_value != 0 || GetDyingCells(w, node) != 0;
+  return node->c.chunk_value != node->saved;
+}
+
+// Writes every live chunk (full) or every chunk that differs from its saved value (delta).
+static bool EncodeSegment(SegmentWriter *sw, const World *w, SnapshotSegmentKind kind) {
+  bool full = kind == SNAPSHOT_SEGMENT_FULL;
+  SnapshotSegmentHeader header = {
+    .magic = SEGMENT_MAGIC,
+    .kind = kind,
+    .generation = w->generation,
+    .removedCount = full ? 0 : w->removedCount,
+  };
+  for (uint32_t i = 0; i < w->count; i++) {
+    if (IsChunkStored(w, w->nodes[i], full)) header.chunkCount++;
+  }
+
+  sw->checksum = 0xcbf29ce484222325ULL;
+  WriteWords(sw, &header, sizeof(header));
+  if (!full) WriteWords(sw, w->removed, w->removedCount * sizeof(ChunkCoord));
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!IsChunkStored(w, node, full)) continue;
+    ChunkCoord coord = { node->x, node->y };
+    WriteWords(sw, &coord, sizeof(coord));
+  }
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!IsChunkStored(w, node, full)) continue;
+    WriteWords(sw, &node->c.chunk_value, sizeof(uint64_t));
+    WriteWords(sw, node->dying, w->planes * sizeof(uint64_t));
+  }
+  uint64_t checksum = sw->checksum;
+  WriteBytes(sw, &checksum, sizeof(checksum));
+  return sw->ok;
+}
+
+static void MarkWorldSaved(World *w) {
+  for (uint32_t i = 0; i < w->count; i++) w->nodes[i]->saved = w->nodes[i]->c.chunk_value;
+  w->removedCount = 0;
+  w->needsFullSave = false;
+}
+
+static bool SyncFile(FILE *file) {
+  return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+// Writes one segment to the file and marks the world saved once it is on disk.
+static bool WriteSegment(FILE *file, World *w, SnapshotSegmentKind kind) {
+  SegmentWriter sw = { .file = file, .ok = true };
+  if (!EncodeSegment(&sw, w, kind) || !SyncFile(file)) return false;
+  MarkWorldSaved(w);
+  return true;
+}
+
+// A full snapshot goes to path.tmp first, which replaces path once complete.
+static FILE *CreateSnapshotFile(const char *path, uint32_t planes, char *tmp, size_t tmpSize) {
+  if (snprintf(tmp, tmpSize, "%s.tmp", path) >= (int)tmpSize) return NULL;
+  FILE *file = fopen(tmp, "wb");
+  if (!file) return NULL;
+  SnapshotFileHeader header = { .version = SNAPSHOT_VERSION, .planes = planes };
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  if (fwrite(&header, sizeof(header), 1, file) == 1) return file;
+  fclose(file);
+  remove(tmp);
+  return NULL;
+}
+
+static bool FinishSnapshotFile(FILE *file, const char *tmp, const char *path, bool ok) {
+  ok = fclose(file) == 0 && ok;
+  if (ok && rename(tmp, path) == 0) return true;
+  remove(tmp);
+  return false;
+}
+
+bool SaveWorldSnapshot(World *w, const char *path) {
+  char tmp[4096];
+  FILE *file = CreateSnapshotFile(path, w->planes, tmp, sizeof(tmp));
+  bool ok = file && FinishSnapshotFile(file, tmp, path, WriteSegment(file, w, SNAPSHOT_SEGMENT_FULL));
+  if (!ok) w->needsFullSave = true;
+  return ok;
+}
+
+bool AppendWorldCheckpoint(World *w, const char *path) {
+  if (w->needsFullSave || w->planes) return SaveWorldSnapshot(w, path);
+  FILE *file = fopen(path, "ab");
+  if (!file) return SaveWorldSnapshot(w, path);
+  bool ok = WriteSegment(file, w, SNAPSHOT_SEGMENT_DELTA);
+  ok = fclose(file) == 0 && ok;
+  // A partial append is ignored by the loader, but the next delta must not build on it.
+  if (!ok) w->needsFullSave = true;
+  return ok;
+}
+
+void EncodeWorldCheckpoint(World *w, bool full, CheckpointBuffer *buffer) {
+  buffer->full = full || w->needsFullSave || w->planes;
+  buffer->planes = w->planes;
+  buffer->generation = w->generation;
+  buffer->length = 0;
+  SegmentWriter sw = { .buffer = buffer, .ok = true };
+  EncodeSegment(&sw, w, buffer->full ? SNAPSHOT_SEGMENT_FULL : SNAPSHOT_SEGMENT_DELTA);
+  MarkWorldSaved(w);
+}
+
+bool WriteWorldCheckpoint(const CheckpointBuffer *buffer, const char *path) {
+  if (buffer->full) {
+    char tmp[4096];
+    FILE *file = CreateSnapshotFile(path, buffer->planes, tmp, sizeof(tmp));
+    if (!file) return false;
+    bool ok = fwrite(buffer->data, 1, buffer->length, file) == buffer->length && SyncFile(file);
+    return FinishSnapshotFile(file, tmp, path, ok);
+  }
+  FILE *file = fopen(path, "ab");
+  if (!file) return false;
+  bool ok = fwrite(buffer->data, 1, buffer->length, file) == buffer->length && SyncFile(file);
+  return fclose(file) == 0 && ok;
+}
+
+void FreeCheckpointBuffer(CheckpointBuffer *buffer) {
+  free(buffer->data);
+  *buffer = (CheckpointBuffer){ 0 };
+}
+
+// Returns the size of the segment at data, or 0 if it is torn, corrupt or unknown.
+static size_t CheckSegment(const unsigned char *data, size_t available, uint32_t planes) {
+  SnapshotSegmentHeader header;
+  if (available < sizeof(header)) return 0;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != SEGMENT_MAGIC) return 0;
+  if (header.kind != SNAPSHOT_SEGMENT_FULL && header.kind != SNAPSHOT_SEGMENT_DELTA) return 0;
+  uint64_t records = header.removedCount + header.chunkCount * (2 + planes);
+  if (header.removedCount > available / 8 || header.chunkCount > available / 16 || records > (available - sizeof(header)) / 8)
+    return 0;
+  size_t payload = sizeof(header) + records * 8;
+  if (available - payload < sizeof(uint64_t)) return 0;
+
+  uint64_t stored;
+  memcpy(&stored, data + payload, sizeof(stored));
+  if (ChecksumWords(0xcbf29ce484222325ULL, data, payload) != stored) return 0;
+  return payload + sizeof(uint64_t);
+}
+
+static void ApplyChunk(World *w, ChunkCoord coord, const uint64_t *words) {
+  if (!w->planes) {
+    SetChunkValue(w, coord.x, coord.y, words[0]);
+    return;
+  }
+  ChunkNode *node = GetOrCreateChunk(w, coord.x, coord.y);
+  node->c.chunk_value = words[0];
+  memcpy(node->dying, words + 1, w->planes * sizeof(uint64_t));
+  WakeChunk(w, node);
+}
+
+static void ApplySegment(World *w, const unsigned char *data) {
+  const SnapshotSegmentHeader *header = (const SnapshotSegmentHeader *)data;
+  const ChunkCoord *removed = (const ChunkCoord *)(header + 1);
+  const ChunkCoord *coords = removed + header->removedCount;
+  const uint64_t *values = (const uint64_t *)(coords + header->chunkCount);
+
+  if (header->kind == SNAPSHOT_SEGMENT_FULL) ClearWorld(w);
+  SetWorldGeneration(w, header->generation);
+  ReserveWorld(w, w->count + (uint32_t)header->chunkCount);
+  for (uint64_t i = 0; i < header->removedCount; i++) SetChunkValue(w, removed[i].x, removed[i].y, 0);
+  for (uint64_t i = 0; i < header->chunkCount; i++) ApplyChunk(w, coords[i], values + i * (1 + w->planes));
+}
+
+bool LoadWorldSnapshot(World *w, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotFileHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t size = (size_t)st.st_size;
+  unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  SnapshotFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  bool ok = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 && header.version == SNAPSHOT_VERSION &&
+            header.planes == w->planes;
+
+  // Only files that start with a full segment are usable; each later delta applies on top.
+  size_t offset = sizeof(header);
+  size_t segments = 0;
+  while (ok && offset < size) {
+    size_t length = CheckSegment(data + offset, size - offset, w->planes);
+    if (length == 0) break;
+    if (segments == 0 && ((const SnapshotSegmentHeader *)(data + offset))->kind != SNAPSHOT_SEGMENT_FULL) break;
+    ApplySegment(w, data + offset);
+    offset += length;
+    segments++;
+  }
+  ok = ok && segments > 0;
+
+  munmap(data, size);
+  close(fd);
+  if (!ok) return false;
+
+  // Only cutting off a torn tail needs write access. Where that is refused, as for a read-only
+  // file, the next checkpoint replaces the file instead of appending after the tail.
+  bool torn = offset < size && truncate(path, (off_t)offset) != 0;
+  MarkWorldSaved(w);
+  w->needsFullSave = torn;
+  return true;
+}
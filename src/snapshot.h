@@ -0,0 +1,68 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "world.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// On-disk world: a file header followed by append-only segments. A segment is a header, the
+// coordinates of removed chunks, the coordinates of stored chunks and then their raw chunk words,
+// all 8-byte aligned so a mapped file is read in place, and a checksum trailer. A full segment
+// replaces the world; a delta holds only what changed since the segment before it.
+//
+// Under a Generations rule each stored chunk has its dying planes after the live word, and the
+// file header records how many. Dying cells change every generation, so those worlds are always
+// written as full segments.
+//
+// Loading replays segments in order and stops at the first torn or corrupt one, so a crash
+// mid-write restores the last complete checkpoint.
+#define SNAPSHOT_MAGIC "LIFESNAP"
+#define SNAPSHOT_VERSION 1
+
+typedef enum {
+  SNAPSHOT_SEGMENT_FULL = 1,
+  SNAPSHOT_SEGMENT_DELTA = 2
+} SnapshotSegmentKind;
+
+typedef struct SnapshotFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t planes; // World.planes; a file only loads into a world with the same count
+} SnapshotFileHeader;
+
+typedef struct SnapshotSegmentHeader {
+  uint32_t magic;
+  uint32_t kind;
+  uint64_t generation;
+  uint64_t removedCount;
+  uint64_t chunkCount;
+} SnapshotSegmentHeader;
+
+// Writes the whole world to a new file and atomically replaces path with it.
+bool SaveWorldSnapshot(World *w, const char *path);
+// Appends the chunks that changed since the last save or load. Falls back to a full snapshot when
+// there is no file yet or the world was cleared since.
+bool AppendWorldCheckpoint(World *w, const char *path);
+// Replaces the world with the last complete checkpoint in path. A torn trailing segment is cut
+// off so later appends follow the last good one; a file that is read-only still loads.
+bool LoadWorldSnapshot(World *w, const char *path);
+
+// One segment encoded in memory, so another thread can write it while the world moves on.
+typedef struct CheckpointBuffer {
+  unsigned char *data;
+  size_t length, capacity;
+  bool full; // Replaces the file; a delta is appended to it
+  uint32_t planes;
+  uint64_t generation;
+} CheckpointBuffer;
+
+// Encodes what SaveWorldSnapshot (full) or AppendWorldCheckpoint would write, reusing the buffer's
+// memory, and marks the world saved straight away. If writing it then fails, the next checkpoint
+// must be full: set w->needsFullSave, and do not write deltas encoded in the meantime.
+void EncodeWorldCheckpoint(World *w, bool full, CheckpointBuffer *buffer);
+// Replaces path with a full checkpoint, or appends a delta to it.
+bool WriteWorldCheckpoint(const CheckpointBuffer *buffer, const char *path);
+void FreeCheckpointBuffer(CheckpointBuffer *buffer);
+
+#endif
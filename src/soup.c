@@ -0,0 +1,903 @@
+#include "period.h"
+#include "world.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Headless soup search: runs many small random soups to stabilisation on worker threads and counts
+// the objects they leave behind.
+//
+//   Soup [--first S] [--count N] [--size N] [--threads N] [--max-gens N] [--radius N]
+//        [--rule B3/S23] [--kernel scalar|avx2|avx512] [--csv file] [--log file]
+//
+// Soup s fills a size x size square at the origin with random cells from seed s, for s in
+// [first, first + count). Each thread claims seeds in batches from one atomic counter and owns
+// everything else: a World whose chunk pool it reuses from soup to soup, a PeriodTracker whose
+// shape cache fills up over the run, and its own object tally and output buffers. Nothing is locked.
+//
+// A soup is stable once nothing needs the stepper (still lifes and blinkers sleep, longer
+// oscillators cycle in the tracker) and every spaceship is heading away from the rest. It is
+// unstable if that takes more than --max-gens generations, and overflows if cells get --radius
+// chunks from the origin. Only stable soups are counted. Objects are named by apgcode (xs4_33 is a
+// block, xp2_7 a blinker, xq4_153 a glider); see ClassifyCells for how cells are grouped.
+// An oscillator the tracker cannot isolate keeps its soup active until --max-gens.
+//
+// --csv appends one line per soup: seed,status,generations,population,objects, where objects is a
+// space-separated list of code*count. --log appends binary records of the same, after an 8-byte
+// "SOUPLOG1" header, all little-endian:
+//
+//   uint64 seed, uint32 generations, uint32 population, uint8 status, uint8 0, uint16 kinds,
+//   then per kind: uint32 count, uint16 length, length bytes of code
+//
+// Workers write whole buffers to O_APPEND files, so lines from different threads never interleave,
+// but soups come out in no particular order. Results do not depend on the thread count. The totals
+// and throughput go to stdout as JSON, one object per line, most common objects first.
+
+#define SOUP_CLAIM 16 // Seeds taken from the counter at a time
+#define SOUP_CHECK_INTERVAL 64 // Generations between radius checks
+#define SOUP_SETTLE_INTERVAL 8 // Generations between spaceship checks once nothing is active
+#define SOUP_OBJECT_MAX_SIDE 40 // Larger objects are counted as ov_ codes by population or period
+#define SOUP_CODE_MAX 384
+#define SOUP_FLUSH_SIZE (1 << 16)
+
+typedef enum {
+  SOUP_STABLE,
+  SOUP_UNSTABLE,
+  SOUP_OVERFLOW,
+  SOUP_STATUS_COUNT
+} SoupStatus;
+
+static const char *SOUP_STATUS_NAMES[SOUP_STATUS_COUNT] = { "stable", "unstable", "overflow" };
+
+typedef struct SoupConfig {
+  uint64_t first;
+  uint64_t count;
+  int size;
+  int threads;
+  uint32_t maxGenerations;
+  int radius;
+  int csv; // File descriptors, -1 when not written
+  int log;
+} SoupConfig;
+
+typedef struct SoupCell {
+  int x, y;
+  uint32_t group;
+  uint64_t phases; // Bit p set if live in phase p
+} SoupCell;
+
+// One soup's objects.
+typedef struct SoupObject {
+  char code[SOUP_CODE_MAX];
+  uint32_t count;
+} SoupObject;
+
+typedef struct TallyEntry {
+  char *code;
+  uint64_t count;
+} TallyEntry;
+
+// Object counts by code: open addressing, grown at half load.
+typedef struct SoupTally {
+  TallyEntry *entries;
+  uint32_t count;
+  uint32_t capacity;
+} SoupTally;
+
+typedef struct SoupBuffer {
+  char *data;
+  size_t length;
+  size_t capacity;
+} SoupBuffer;
+
+// apgcodes of the objects in one tracker shape, each NUL-terminated, back to back.
+typedef struct ShapeObjects {
+  char *codes;
+  size_t length;
+  uint32_t count;
+} ShapeObjects;
+
+typedef struct SoupSearch SoupSearch;
+
+typedef struct SoupWorker {
+  pthread_t thread;
+  SoupSearch *search;
+  World world;
+  PeriodTracker periods;
+  ShapeObjects *shapeObjects; // What each tracker shape is made of, filled in as shapes appear
+  uint32_t shapeObjectCount;
+  uint32_t shapeObjectCapacity;
+  SoupObject *objects;
+  uint32_t objectCount;
+  uint32_t objectCapacity;
+  ShapeObjects worldObjects; // The current soup's, outside the tracker
+  World scratch; // Parts of objects are run alone here
+  SoupCell *cells; // Cells being grouped
+  uint32_t cellCapacity;
+  SoupCell *phaseCells; // Objects' cells, phase after phase
+  uint32_t phaseCellCapacity;
+  SoupCell *partCells; // Phase 0 of a group, split into parts
+  uint32_t partCellCapacity;
+  uint32_t *ends; // Phase ends of each part in phaseCells
+  uint32_t endCapacity;
+  uint32_t *stack;
+  uint32_t stackCapacity;
+  uint64_t *footprint; // Phase bits over a tracker shape's footprint
+  SoupTally tally;
+  SoupBuffer csv;
+  SoupBuffer log;
+  uint64_t soups[SOUP_STATUS_COUNT];
+  uint64_t generations;
+} SoupWorker;
+
+struct SoupSearch {
+  SoupConfig cfg;
+  atomic_uint_fast64_t next; // Seeds claimed so far, relative to first
+};
+
+static uint64_t SplitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void AppendBytes(SoupBuffer *b, const void *data, size_t length) {
+  if (b->length + length > b->capacity) {
+    while (b->length + length > b->capacity) b->capacity = b->capacity ? b->capacity * 2 : SOUP_FLUSH_SIZE * 2;
+    b->data = realloc(b->data, b->capacity);
+  }
+  memcpy(b->data + b->length, data, length);
+  b->length += length;
+}
+
+static void AppendText(SoupBuffer *b, const char *text) {
+  AppendBytes(b, text, strlen(text));
+}
+
+// One write per buffer: with O_APPEND the kernel places it whole at the end of the file.
+static void FlushBuffer(SoupBuffer *b, int fd, bool force) {
+  if (fd < 0 || !b->length || (!force && b->length < SOUP_FLUSH_SIZE)) return;
+  size_t done = 0;
+  while (done < b->length) {
+    ssize_t n = write(fd, b->data + done, b->length - done);
+    if (n <= 0) break;
+    done += (size_t)n;
+  }
+  b->length = 0;
+}
+
+static uint64_t HashCode(const char *code) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (; *code; code++) h = (h ^ (uint8_t)*code) * 0x100000001b3ULL;
+  return h;
+}
+
+static void InsertTallyEntry(TallyEntry *entries, uint32_t capacity, TallyEntry entry) {
+  uint32_t mask = capacity - 1;
+  uint32_t i = (uint32_t)HashCode(entry.code) & mask;
+  while (entries[i].code) i = (i + 1) & mask;
+  entries[i] = entry;
+}
+
+static void AddToTally(SoupTally *t, const char *code, uint64_t count) {
+  if ((t->count + 1) * 2 > t->capacity) {
+    uint32_t capacity = t->capacity ? t->capacity * 2 : 256;
+    TallyEntry *entries = calloc(capacity, sizeof(TallyEntry));
+    for (uint32_t i = 0; i < t->capacity; i++) {
+      if (t->entries[i].code) InsertTallyEntry(entries, capacity, t->entries[i]);
+    }
+    free(t->entries);
+    t->entries = entries;
+    t->capacity = capacity;
+  }
+  uint32_t mask = t->capacity - 1;
+  uint32_t i = (uint32_t)HashCode(code) & mask;
+  for (; t->entries[i].code; i = (i + 1) & mask) {
+    if (strcmp(t->entries[i].code, code) == 0) {
+      t->entries[i].count += count;
+      return;
+    }
+  }
+  t->entries[i] = (TallyEntry){ strdup(code), count };
+  t->count++;
+}
+
+static void FreeTally(SoupTally *t) {
+  for (uint32_t i = 0; i < t->capacity; i++) free(t->entries[i].code);
+  free(t->entries);
+  *t = (SoupTally){ 0 };
+}
+
+static const char CODE_DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// Extended Wechsler format of the cells under one of the 8 symmetries (bit 2 swaps the axes, bits
+// 0 and 1 mirror x and y): 5-row strips, one base-32 digit per column, runs of zeros as w, x or
+// y plus a count, strips joined by z. Fails if the object is larger than SOUP_OBJECT_MAX_SIDE.
+static bool EncodeCells(const SoupCell *cells, uint32_t count, int symmetry, char *out) {
+  int minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+  for (uint32_t i = 0; i < count; i++) {
+    int x = symmetry & 4 ? cells[i].y : cells[i].x;
+    int y = symmetry & 4 ? cells[i].x : cells[i].y;
+    x = symmetry & 1 ? -x : x;
+    y = symmetry & 2 ? -y : y;
+    if (x < minX) minX = x;
+    if (y < minY) minY = y;
+    if (x > maxX) maxX = x;
+    if (y > maxY) maxY = y;
+  }
+  int width = maxX - minX + 1, height = maxY - minY + 1;
+  if (width > SOUP_OBJECT_MAX_SIDE || height > SOUP_OBJECT_MAX_SIDE) return false;
+  uint8_t columns[(SOUP_OBJECT_MAX_SIDE + 4) / 5][SOUP_OBJECT_MAX_SIDE] = { 0 };
+  for (uint32_t i = 0; i < count; i++) {
+    int x = symmetry & 4 ? cells[i].y : cells[i].x;
+    int y = symmetry & 4 ? cells[i].x : cells[i].y;
+    x = (symmetry & 1 ? -x : x) - minX;
+    y = (symmetry & 2 ? -y : y) - minY;
+    columns[y / 5][x] |= (uint8_t)(1 << (y % 5));
+  }
+
+  size_t length = 0;
+  for (int strip = 0; strip < (height + 4) / 5; strip++) {
+    if (strip) out[length++] = 'z';
+    int end = width;
+    while (end > 0 && !columns[strip][end - 1]) end--;
+    for (int x = 0; x < end;) {
+      if (columns[strip][x]) {
+        out[length++] = CODE_DIGITS[columns[strip][x++]];
+        continue;
+      }
+      int run = 0;
+      while (x < end && !columns[strip][x]) run++, x++;
+      for (; run >= 4; run -= run < 39 ? run : 39) {
+        out[length++] = 'y';
+        out[length++] = CODE_DIGITS[(run < 39 ? run : 39) - 4];
+      }
+      if (run == 3) out[length++] = 'x';
+      else if (run == 2) out[length++] = 'w';
+      else if (run == 1) out[length++] = '0';
+    }
+  }
+  out[length] = '\0';
+  return true;
+}
+
+// apgcode: prefix, then the shortest and first in byte order of every phase's encodings under every
+// symmetry. phases holds the end of each phase in cells.
+static void MakeCode(const SoupCell *cells, const uint32_t *phases, uint32_t phaseCount, const char *prefix,
+                     const char *oversized, char *code) {
+  char best[SOUP_CODE_MAX], candidate[SOUP_CODE_MAX];
+  size_t bestLength = SIZE_MAX;
+  for (uint32_t p = 0; p < phaseCount; p++) {
+    uint32_t begin = p ? phases[p - 1] : 0;
+    for (int symmetry = 0; symmetry < 8; symmetry++) {
+      if (!EncodeCells(cells + begin, phases[p] - begin, symmetry, candidate)) {
+        snprintf(code, SOUP_CODE_MAX, "%s", oversized);
+        return;
+      }
+      size_t length = strlen(candidate);
+      if (length < bestLength || (length == bestLength && strcmp(candidate, best) < 0)) {
+        memcpy(best, candidate, length + 1);
+        bestLength = length;
+      }
+    }
+  }
+  snprintf(code, SOUP_CODE_MAX, "%s%s", prefix, best);
+}
+
+static SoupCell *ReserveCells(SoupCell **cells, uint32_t *capacity, uint32_t count) {
+  if (count > *capacity) {
+    *capacity = count * 2;
+    *cells = realloc(*cells, *capacity * sizeof(SoupCell));
+  }
+  return *cells;
+}
+
+static void AddObject(SoupWorker *wk, const char *code) {
+  for (uint32_t i = 0; i < wk->objectCount; i++) {
+    if (strcmp(wk->objects[i].code, code) == 0) {
+      wk->objects[i].count++;
+      return;
+    }
+  }
+  if (wk->objectCount == wk->objectCapacity) {
+    wk->objectCapacity = wk->objectCapacity ? wk->objectCapacity * 2 : 32;
+    wk->objects = realloc(wk->objects, wk->objectCapacity * sizeof(SoupObject));
+  }
+  SoupObject *o = &wk->objects[wk->objectCount++];
+  snprintf(o->code, SOUP_CODE_MAX, "%s", code);
+  o->count = 1;
+}
+
+static void AddShapeObject(ShapeObjects *out, const char *code) {
+  size_t size = strlen(code) + 1;
+  out->codes = realloc(out->codes, out->length + size);
+  memcpy(out->codes + out->length, code, size);
+  out->length += size;
+  out->count++;
+}
+
+static void MinCorner(const SoupCell *cells, uint32_t count, int *x, int *y) {
+  *x = *y = INT32_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    if (cells[i].x < *x) *x = cells[i].x;
+    if (cells[i].y < *y) *y = cells[i].y;
+  }
+}
+
+// Names an object from its phases over the period it was found with. That period may be a multiple
+// of its own (a tracker shape's is on the chunk grid); its own is the first phase that is phase 0
+// again, possibly moved.
+static void NameObject(const SoupCell *cells, const uint32_t *phases, uint32_t period, bool moves, char *code) {
+  char first[SOUP_CODE_MAX], other[SOUP_CODE_MAX];
+  uint32_t own = period;
+  if (EncodeCells(cells, phases[0], 0, first)) {
+    for (uint32_t p = 1; p < period; p++) {
+      const SoupCell *phase = cells + phases[p - 1];
+      uint32_t count = phases[p] - phases[p - 1];
+      if (period % p || !EncodeCells(phase, count, 0, other) || strcmp(first, other) != 0) continue;
+      int x0, y0, x1, y1;
+      MinCorner(cells, phases[0], &x0, &y0);
+      MinCorner(phase, count, &x1, &y1);
+      own = p;
+      moves = x0 != x1 || y0 != y1;
+      break;
+    }
+  }
+  char prefix[32], oversized[32];
+  if (moves) {
+    snprintf(prefix, sizeof(prefix), "xq%u_", own);
+    snprintf(oversized, sizeof(oversized), "ov_q%u", own);
+  } else if (own == 1) {
+    snprintf(prefix, sizeof(prefix), "xs%u_", phases[0]);
+    snprintf(oversized, sizeof(oversized), "ov_s%u", phases[0]);
+  } else {
+    snprintf(prefix, sizeof(prefix), "xp%u_", own);
+    snprintf(oversized, sizeof(oversized), "ov_p%u", own);
+  }
+  MakeCode(cells, phases, own, prefix, oversized, code);
+}
+
+static int CompareCells(const void *a, const void *b) {
+  const SoupCell *p = a, *q = b;
+  if (p->group != q->group) return p->group < q->group ? -1 : 1;
+  if (p->y != q->y) return p->y < q->y ? -1 : 1;
+  return (p->x > q->x) - (p->x < q->x);
+}
+
+// Index of the cell at (x, y) in cells sorted by row then column, or -1.
+static int64_t FindCell(const SoupCell *cells, uint32_t count, int x, int y) {
+  uint32_t lo = 0, hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (cells[mid].y < y || (cells[mid].y == y && cells[mid].x < x)) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo < count && cells[lo].x == x && cells[lo].y == y ? (int64_t)lo : -1;
+}
+
+// Splits cells sorted by row then column into groups linked by steps of up to reach cells in each
+// direction, and sorts them by group. Returns the number of groups.
+static uint32_t GroupCells(SoupWorker *wk, SoupCell *cells, uint32_t count, int reach) {
+  if (count > wk->stackCapacity) {
+    wk->stackCapacity = count * 2;
+    wk->stack = realloc(wk->stack, wk->stackCapacity * sizeof(uint32_t));
+  }
+  for (uint32_t i = 0; i < count; i++) cells[i].group = UINT32_MAX;
+  uint32_t groups = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (cells[i].group != UINT32_MAX) continue;
+    uint32_t stacked = 0;
+    cells[i].group = groups;
+    wk->stack[stacked++] = i;
+    while (stacked) {
+      const SoupCell *cell = &cells[wk->stack[--stacked]];
+      for (int dy = -reach; dy <= reach; dy++) {
+        for (int dx = -reach; dx <= reach; dx++) {
+          int64_t j = FindCell(cells, count, cell->x + dx, cell->y + dy);
+          if (j < 0 || cells[j].group != UINT32_MAX) continue;
+          cells[j].group = groups;
+          wk->stack[stacked++] = (uint32_t)j;
+        }
+      }
+    }
+    groups++;
+  }
+  qsort(cells, count, sizeof(SoupCell), CompareCells);
+  return groups;
+}
+
+static void NameCells(SoupWorker *wk, const SoupCell *cells, uint32_t count, uint32_t period, bool moves,
+                      ShapeObjects *out) {
+  SoupCell *phaseCells = ReserveCells(&wk->phaseCells, &wk->phaseCellCapacity, count * period);
+  uint32_t phases[PERIOD_MAX] = { 0 }, end = 0;
+  for (uint32_t p = 0; p < period; p++) {
+    uint32_t begin = end;
+    for (uint32_t i = 0; i < count; i++) {
+      if (cells[i].phases >> p & 1) phaseCells[end++] = cells[i];
+    }
+    // Births are next to live cells, so no group is ever empty in a phase; skip it if one is.
+    if (end == begin) return;
+    phases[p] = end;
+  }
+  char code[SOUP_CODE_MAX];
+  NameObject(phaseCells, phases, period, moves, code);
+  AddShapeObject(out, code);
+}
+
+// Splits a group along the 8-connected parts of one of its phases, if every part run alone stays
+// inside the group and all of them together make up each of its phases. Names the parts and returns
+// true on success.
+static bool SplitGroup(SoupWorker *wk, const SoupCell *group, uint32_t size, uint32_t phase, uint32_t period, int dx,
+                       int dy, ShapeObjects *out) {
+  uint32_t populations[PERIOD_MAX] = { 0 }, count = 0;
+  SoupCell *parts = ReserveCells(&wk->partCells, &wk->partCellCapacity, size);
+  for (uint32_t i = 0; i < size; i++) {
+    for (uint32_t p = 0; p < period; p++) populations[p] += group[i].phases >> p & 1;
+    if (group[i].phases >> phase & 1) parts[count++] = group[i];
+  }
+  uint32_t partCount = GroupCells(wk, parts, count, 1);
+  if (partCount < 2) return false;
+  if (partCount * period > wk->endCapacity) {
+    wk->endCapacity = partCount * period * 2;
+    wk->ends = realloc(wk->ends, wk->endCapacity * sizeof(uint32_t));
+  }
+
+  // Run each part alone for a period, keeping its phases back to back in phaseCells. The group's
+  // phases before the starting one come round again a period's displacement further on.
+  World *w = &wk->scratch;
+  uint32_t totals[PERIOD_MAX] = { 0 }, end = 0;
+  for (uint32_t a = 0, b, part = 0; a < count; a = b, part++) {
+    for (b = a; b < count && parts[b].group == parts[a].group; b++) {}
+    uint32_t start = end, *ends = wk->ends + part * period;
+    ClearWorld(w);
+    ReserveCells(&wk->phaseCells, &wk->phaseCellCapacity, end + b - a);
+    for (uint32_t i = a; i < b; i++) {
+      SetWorldCell(w, parts[i].x, parts[i].y, true);
+      wk->phaseCells[end++] = parts[i];
+    }
+    ends[0] = end - start;
+    totals[phase] += b - a;
+    for (uint32_t k = 1; k <= period; k++) {
+      StepWorld(w);
+      uint32_t p = (phase + k) % period, population = 0;
+      int x0 = phase + k >= period ? dx : 0, y0 = phase + k >= period ? dy : 0;
+      for (uint32_t i = 0; i < w->count; i++) {
+        const ChunkNode *node = w->nodes[i];
+        population += (uint32_t)__builtin_popcountll(node->c.chunk_value);
+        if (k == period) continue;
+        ReserveCells(&wk->phaseCells, &wk->phaseCellCapacity, end + 64);
+        for (uint64_t bits = node->c.chunk_value; bits; bits &= bits - 1) {
+          int bit = __builtin_ctzll(bits);
+          int x = node->x * CHUNK_SIZE + bit % BLOCK_SIZE, y = node->y * CHUNK_SIZE + bit / BLOCK_SIZE;
+          int64_t j = FindCell(group, size, x - x0, y - y0);
+          if (j < 0 || !(group[j].phases >> p & 1)) return false;
+          wk->phaseCells[end++] = (SoupCell){ x, y, 0, 0 };
+        }
+      }
+      if (k < period) {
+        ends[k] = end - start;
+        totals[p] += population;
+        continue;
+      }
+      if (population != b - a) return false;
+      for (uint32_t i = a; i < b; i++) {
+        if (!GetWorldCell(w, parts[i].x + dx, parts[i].y + dy)) return false;
+      }
+    }
+  }
+  if (memcmp(totals, populations, period * sizeof(uint32_t)) != 0) return false;
+
+  for (uint32_t part = 0, start = 0; part < partCount; part++) {
+    const uint32_t *ends = wk->ends + part * period;
+    char code[SOUP_CODE_MAX];
+    NameObject(wk->phaseCells + start, ends, period, dx || dy, code);
+    AddShapeObject(out, code);
+    start += ends[period - 1];
+  }
+  return true;
+}
+
+// Names the objects among wk->cells[0, count), each with its phases as bits. Cells up to two apart
+// can affect each other, so they are grouped that far (apgsearch does the same), and a group is
+// then split where the parts of some phase turn out to be independent: a still life whose halves only share dead
+// neighbours stays one object, while two blocks near each other count as two.
+static void ClassifyCells(SoupWorker *wk, uint32_t count, uint32_t period, int dx, int dy, ShapeObjects *out) {
+  SoupCell *cells = wk->cells;
+  for (uint32_t i = 0; i < count; i++) cells[i].group = 0;
+  qsort(cells, count, sizeof(SoupCell), CompareCells);
+  GroupCells(wk, cells, count, 2);
+  for (uint32_t begin = 0, end; begin < count; begin = end) {
+    for (end = begin; end < count && cells[end].group == cells[begin].group; end++) {}
+    // Phases that are the same cells as phase 0 would split the same way.
+    uint64_t changing = 0;
+    for (uint32_t i = begin; i < end; i++) changing |= cells[i].phases ^ (cells[i].phases & 1 ? ~0ULL : 0);
+    bool split = false;
+    for (uint32_t phase = 0; phase < period && !split; phase++) {
+      if (!phase || changing >> phase & 1) split = SplitGroup(wk, cells + begin, end - begin, phase, period, dx, dy, out);
+    }
+    if (!split) NameCells(wk, cells + begin, end - begin, period, dx || dy, out);
+  }
+}
+
+#define SHAPE_SIDE (PERIOD_MAX_SIDE * CHUNK_SIZE)
+
+static void ClassifyShape(SoupWorker *wk, const PeriodShape *s, ShapeObjects *out) {
+  memset(wk->footprint, 0, SHAPE_SIDE * SHAPE_SIDE * sizeof(uint64_t));
+  for (uint32_t p = 0; p < s->period; p++) {
+    const uint64_t *values = s->phases + (size_t)p * s->width * s->height;
+    for (int j = 0; j < s->width * s->height; j++) {
+      for (uint64_t bits = values[j]; bits; bits &= bits - 1) {
+        int b = __builtin_ctzll(bits);
+        int x = (j % s->width) * CHUNK_SIZE + b % BLOCK_SIZE, y = (j / s->width) * CHUNK_SIZE + b / BLOCK_SIZE;
+        wk->footprint[y * SHAPE_SIDE + x] |= 1ULL << p;
+      }
+    }
+  }
+  uint32_t count = 0;
+  for (int i = 0; i < SHAPE_SIDE * SHAPE_SIDE; i++) {
+    if (!wk->footprint[i]) continue;
+    ReserveCells(&wk->cells, &wk->cellCapacity, count + 1);
+    wk->cells[count++] = (SoupCell){ i % SHAPE_SIDE, i / SHAPE_SIDE, 0, wk->footprint[i] };
+  }
+  *out = (ShapeObjects){ 0 };
+  ClassifyCells(wk, count, s->period, s->dx * CHUNK_SIZE, s->dy * CHUNK_SIZE, out);
+}
+
+static void AddShapeObjects(SoupWorker *wk, uint32_t index) {
+  const PeriodTracker *t = &wk->periods;
+  if (t->shapeCount > wk->shapeObjectCapacity) {
+    wk->shapeObjectCapacity = t->shapeCount * 2;
+    wk->shapeObjects = realloc(wk->shapeObjects, wk->shapeObjectCapacity * sizeof(ShapeObjects));
+  }
+  for (; wk->shapeObjectCount < t->shapeCount; wk->shapeObjectCount++)
+    ClassifyShape(wk, &t->shapes[wk->shapeObjectCount], &wk->shapeObjects[wk->shapeObjectCount]);
+  const ShapeObjects *objects = &wk->shapeObjects[index];
+  const char *code = objects->codes;
+  for (uint32_t i = 0; i < objects->count; i++, code += strlen(code) + 1) AddObject(wk, code);
+}
+
+// The settled world outside the tracker holds still lifes and period 2 oscillators: a sleeping
+// chunk's previous generation is its other phase.
+static void AddWorldObjects(SoupWorker *wk) {
+  const World *w = &wk->world;
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (node->periodic) continue;
+    uint64_t now = node->c.chunk_value, before = node->prev.chunk_value;
+    ReserveCells(&wk->cells, &wk->cellCapacity, count + 64);
+    for (uint64_t bits = now | before; bits; bits &= bits - 1) {
+      int b = __builtin_ctzll(bits);
+      wk->cells[count++] = (SoupCell){ node->x * CHUNK_SIZE + b % BLOCK_SIZE, node->y * CHUNK_SIZE + b / BLOCK_SIZE,
+                                       0, (now >> b & 1) | (before >> b & 1) << 1 };
+    }
+  }
+  ShapeObjects *objects = &wk->worldObjects;
+  objects->count = 0;
+  objects->length = 0;
+  ClassifyCells(wk, count, 2, 0, 0, objects);
+  const char *code = objects->codes;
+  for (uint32_t i = 0; i < objects->count; i++, code += strlen(code) + 1) AddObject(wk, code);
+}
+
+// True once every mover is beyond the rest of the pattern on a side it is moving away from, so it
+// can never meet anything again. The cells have settled, so their bounds no longer change.
+static bool AreMoversEscaping(const SoupWorker *wk) {
+  const World *w = &wk->world;
+  const PeriodTracker *t = &wk->periods;
+  if (!t->moverCount) return true;
+  int minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!node->c.chunk_value && !node->prev.chunk_value && !node->periodic) continue;
+    if (node->x < minX) minX = node->x;
+    if (node->y < minY) minY = node->y;
+    if (node->x > maxX) maxX = node->x;
+    if (node->y > maxY) maxY = node->y;
+  }
+  for (uint32_t i = 0; i < t->moverCount; i++) {
+    const PeriodMover *m = &t->movers[i];
+    const PeriodShape *s = &t->shapes[m->shape];
+    int x, y;
+    uint32_t phase;
+    LocatePeriodMover(t, m, w->generation, &x, &y, &phase);
+    int gap = PERIOD_MOVER_MARGIN;
+    bool away = (s->dx > 0 && x > maxX + gap) || (s->dx < 0 && x + s->width - 1 < minX - gap) ||
+                (s->dy > 0 && y > maxY + gap) || (s->dy < 0 && y + s->height - 1 < minY - gap);
+    if (!away) return false;
+  }
+  return true;
+}
+
+static bool IsInsideRadius(const World *w, int radius) {
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (node->c.chunk_value && (abs(node->x) > radius || abs(node->y) > radius)) return false;
+  }
+  return true;
+}
+
+static void SeedSoup(World *w, int size, uint64_t seed) {
+  uint64_t rng = seed;
+  int chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  for (int y = 0; y < chunks; y++) {
+    for (int x = 0; x < chunks; x++) {
+      uint64_t mask = ~0ULL;
+      int columns = size - x * CHUNK_SIZE, rows = size - y * CHUNK_SIZE;
+      if (columns < CHUNK_SIZE) mask &= 0x0101010101010101ULL * ((1u << columns) - 1);
+      if (rows < CHUNK_SIZE) mask &= (1ULL << rows * BLOCK_SIZE) - 1;
+      SetChunkValue(w, x, y, SplitMix64(&rng) & mask);
+    }
+  }
+}
+
+static void AppendSoupRecord(SoupWorker *wk, uint64_t seed, SoupStatus status, uint32_t generations,
+                             uint32_t population) {
+  const SoupConfig *cfg = &wk->search->cfg;
+  if (cfg->csv >= 0) {
+    char line[128];
+    snprintf(line, sizeof(line), "%llu,%s,%u,%u,", (unsigned long long)seed, SOUP_STATUS_NAMES[status],
+             generations, population);
+    AppendText(&wk->csv, line);
+    for (uint32_t i = 0; i < wk->objectCount; i++) {
+      snprintf(line, sizeof(line), "*%u", wk->objects[i].count);
+      if (i) AppendText(&wk->csv, " ");
+      AppendText(&wk->csv, wk->objects[i].code);
+      AppendText(&wk->csv, line);
+    }
+    AppendText(&wk->csv, "\n");
+    FlushBuffer(&wk->csv, cfg->csv, false);
+  }
+  if (cfg->log >= 0) {
+    uint8_t header[20];
+    uint16_t kinds = (uint16_t)wk->objectCount;
+    memcpy(header, &seed, 8);
+    memcpy(header + 8, &generations, 4);
+    memcpy(header + 12, &population, 4);
+    header[16] = (uint8_t)status;
+    header[17] = 0;
+    memcpy(header + 18, &kinds, 2);
+    AppendBytes(&wk->log, header, sizeof(header));
+    for (uint32_t i = 0; i < wk->objectCount; i++) {
+      uint16_t length = (uint16_t)strlen(wk->objects[i].code);
+      AppendBytes(&wk->log, &wk->objects[i].count, 4);
+      AppendBytes(&wk->log, &length, 2);
+      AppendBytes(&wk->log, wk->objects[i].code, length);
+    }
+    FlushBuffer(&wk->log, cfg->log, false);
+  }
+}
+
+static void RunSoup(SoupWorker *wk, uint64_t seed) {
+  const SoupConfig *cfg = &wk->search->cfg;
+  World *w = &wk->world;
+  PeriodTracker *t = &wk->periods;
+  // Starting every soup at generation 0 keeps the tracker's sampling in step across threads.
+  ClearWorld(w);
+  w->generation = 0;
+  SeedSoup(w, cfg->size, seed);
+
+  SoupStatus status = SOUP_UNSTABLE;
+  uint32_t generation = 0;
+  while (generation < cfg->maxGenerations) {
+    StepWorld(w);
+    generation++;
+    if (!w->active.count && generation % SOUP_SETTLE_INTERVAL == 0 && AreMoversEscaping(wk)) {
+      status = SOUP_STABLE;
+      break;
+    }
+    if (generation % SOUP_CHECK_INTERVAL == 0 && !IsInsideRadius(w, cfg->radius)) {
+      status = SOUP_OVERFLOW;
+      break;
+    }
+  }
+
+  uint32_t population = 0;
+  for (uint32_t i = 0; i < w->count; i++) population += (uint32_t)__builtin_popcountll(w->nodes[i]->c.chunk_value);
+  for (uint32_t i = 0; i < t->moverCount; i++) population += t->shapes[t->movers[i].shape].population;
+  wk->objectCount = 0;
+  if (status == SOUP_STABLE) {
+    for (uint32_t i = 0; i < t->moverCount; i++) AddShapeObjects(wk, t->movers[i].shape);
+    for (uint32_t i = 0; i < t->oscillatorCount; i++) AddShapeObjects(wk, t->oscillators[i].shape);
+    AddWorldObjects(wk);
+    for (uint32_t i = 0; i < wk->objectCount; i++) AddToTally(&wk->tally, wk->objects[i].code, wk->objects[i].count);
+  }
+  wk->soups[status]++;
+  wk->generations += generation;
+  AppendSoupRecord(wk, seed, status, generation, population);
+}
+
+static void *SoupWorkerMain(void *arg) {
+  SoupWorker *wk = arg;
+  SoupSearch *search = wk->search;
+  for (;;) {
+    uint64_t begin = atomic_fetch_add_explicit(&search->next, SOUP_CLAIM, memory_order_relaxed);
+    if (begin >= search->cfg.count) break;
+    uint64_t end = begin + SOUP_CLAIM < search->cfg.count ? begin + SOUP_CLAIM : search->cfg.count;
+    for (uint64_t i = begin; i < end; i++) RunSoup(wk, search->cfg.first + i);
+  }
+  FlushBuffer(&wk->csv, search->cfg.csv, true);
+  FlushBuffer(&wk->log, search->cfg.log, true);
+  return NULL;
+}
+
+static void InitSoupWorker(SoupWorker *wk, SoupSearch *search) {
+  *wk = (SoupWorker){ .search = search };
+  InitWorld(&wk->world, 256);
+  InitWorld(&wk->scratch, 64);
+  wk->footprint = malloc(SHAPE_SIDE * SHAPE_SIDE * sizeof(uint64_t));
+  InitPeriodTracker(&wk->periods);
+  wk->periods.recheckCached = true;
+  wk->world.periods = &wk->periods;
+}
+
+static void FreeSoupWorker(SoupWorker *wk) {
+  FreeWorld(&wk->world);
+  FreePeriodTracker(&wk->periods);
+  for (uint32_t i = 0; i < wk->shapeObjectCount; i++) free(wk->shapeObjects[i].codes);
+  free(wk->shapeObjects);
+  free(wk->worldObjects.codes);
+  FreeWorld(&wk->scratch);
+  free(wk->objects);
+  free(wk->cells);
+  free(wk->phaseCells);
+  free(wk->partCells);
+  free(wk->ends);
+  free(wk->stack);
+  free(wk->footprint);
+  FreeTally(&wk->tally);
+  free(wk->csv.data);
+  free(wk->log.data);
+}
+
+static int CompareTallyEntries(const void *a, const void *b) {
+  const TallyEntry *x = a, *y = b;
+  if (x->count != y->count) return x->count > y->count ? -1 : 1;
+  return strcmp(x->code, y->code);
+}
+
+static int OpenOutput(const char *path) {
+  return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [--first S] [--count N] [--size N] [--threads N] [--max-gens N] [--radius N]\n"
+                  "          [--rule B3/S23] [--kernel scalar|avx2|avx512] [--csv file] [--log file]\n", name);
+}
+
+int main(int argc, char **argv) {
+  SoupSearch search = { .cfg = { .first = 1, .count = 1000, .size = 16, .maxGenerations = 20000, .radius = 64,
+                                 .csv = -1, .log = -1 } };
+  const char *csvPath = NULL, *logPath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--first") == 0 && value) {
+      search.cfg.first = strtoull(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--count") == 0 && value) {
+      search.cfg.count = strtoull(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      search.cfg.size = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      search.cfg.threads = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--max-gens") == 0 && value) {
+      search.cfg.maxGenerations = (uint32_t)strtoul(value, NULL, 0);
+      i++;
+    } else if (strcmp(arg, "--radius") == 0 && value) {
+      search.cfg.radius = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--kernel") == 0 && value) {
+      int k = 0;
+      while (k < STEP_KERNEL_COUNT && strcmp(value, GetStepKernelName((StepKernel)k)) != 0) k++;
+      if (!SetStepKernel((StepKernel)k)) {
+        fprintf(stderr, "step kernel '%s' is not supported on this CPU\n", value);
+        return 1;
+      }
+      i++;
+    } else if (strcmp(arg, "--rule") == 0 && value) {
+      Rule rule;
+      if (!ParseRule(value, &rule) || GetRuleDyingPlanes(rule)) {
+        fprintf(stderr, "invalid rule '%s' (two-state rules without B0 only)\n", value);
+        return 1;
+      }
+      SetStepRule(rule);
+      i++;
+    } else if (strcmp(arg, "--csv") == 0 && value) {
+      csvPath = value;
+      i++;
+    } else if (strcmp(arg, "--log") == 0 && value) {
+      logPath = value;
+      i++;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (search.cfg.size <= 0 || search.cfg.radius <= 0 || !search.cfg.maxGenerations) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (search.cfg.threads <= 0) search.cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (csvPath && (search.cfg.csv = OpenOutput(csvPath)) < 0) {
+    fprintf(stderr, "cannot create '%s'\n", csvPath);
+    return 1;
+  }
+  if (logPath && (search.cfg.log = OpenOutput(logPath)) < 0) {
+    fprintf(stderr, "cannot create '%s'\n", logPath);
+    if (search.cfg.csv >= 0) close(search.cfg.csv);
+    return 1;
+  }
+  SoupBuffer header = { 0 };
+  AppendText(&header, "seed,status,generations,population,objects\n");
+  FlushBuffer(&header, search.cfg.csv, true);
+  AppendText(&header, "SOUPLOG1");
+  FlushBuffer(&header, search.cfg.log, true);
+  free(header.data);
+
+  int threads = search.cfg.threads;
+  SoupWorker *workers = malloc(threads * sizeof(SoupWorker));
+  for (int i = 0; i < threads; i++) InitSoupWorker(&workers[i], &search);
+  double start = NowSeconds();
+  for (int i = 1; i < threads; i++) pthread_create(&workers[i].thread, NULL, SoupWorkerMain, &workers[i]);
+  SoupWorkerMain(&workers[0]);
+  for (int i = 1; i < threads; i++) pthread_join(workers[i].thread, NULL);
+  double seconds = NowSeconds() - start;
+
+  uint64_t soups[SOUP_STATUS_COUNT] = { 0 }, generations = 0;
+  SoupTally total = { 0 };
+  for (int i = 0; i < threads; i++) {
+    for (int s = 0; s < SOUP_STATUS_COUNT; s++) soups[s] += workers[i].soups[s];
+    generations += workers[i].generations;
+    for (uint32_t j = 0; j < workers[i].tally.capacity; j++) {
+      const TallyEntry *e = &workers[i].tally.entries[j];
+      if (e->code) AddToTally(&total, e->code, e->count);
+    }
+    FreeSoupWorker(&workers[i]);
+  }
+  free(workers);
+  if (search.cfg.csv >= 0) close(search.cfg.csv);
+  if (search.cfg.log >= 0) close(search.cfg.log);
+
+  char rule[RULE_TEXT_MAX];
+  FormatRule(GetStepRule(), rule);
+  uint64_t count = search.cfg.count;
+  printf("{\"first\":%llu,\"soups\":%llu,\"size\":%d,\"rule\":\"%s\",\"kernel\":\"%s\",\"threads\":%d,"
+         "\"stable\":%llu,\"unstable\":%llu,\"overflow\":%llu,\"generations\":%llu,\"seconds\":%.6f,"
+         "\"soups_per_sec\":%.1f,\"soups_per_sec_per_core\":%.1f}\n",
+         (unsigned long long)search.cfg.first, (unsigned long long)count, search.cfg.size, rule,
+         GetStepKernelName(GetStepKernel()), threads, (unsigned long long)soups[SOUP_STABLE],
+         (unsigned long long)soups[SOUP_UNSTABLE], (unsigned long long)soups[SOUP_OVERFLOW],
+         (unsigned long long)generations, seconds, seconds > 0 ? count / seconds : 0.0,
+         seconds > 0 ? count / seconds / threads : 0.0);
+
+  // Compact the table in place to sort it.
+  uint32_t kinds = 0;
+  for (uint32_t i = 0; i < total.capacity; i++) {
+    if (total.entries[i].code) total.entries[kinds++] = total.entries[i];
+  }
+  qsort(total.entries, kinds, sizeof(TallyEntry), CompareTallyEntries);
+  for (uint32_t i = 0; i < kinds; i++)
+    printf("{\"object\":\"%s\",\"count\":%llu}\n", total.entries[i].code, (unsigned long long)total.entries[i].count);
+  for (uint32_t i = 0; i < kinds; i++) free(total.entries[i].code);
+  free(total.entries);
+  return 0;
+}
@@ -0,0 +1,424 @@
+#include "world.h"
+#include "halo.h"
+#include "period.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint32_t HashChunkCoords(int x, int y) {
+  uint64_t h = ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+void InitWorld(World *w, uint32_t capacity) {
+  uint32_t cap = 16;
+  while (cap < capacity * 2) cap <<= 1;
+  Rule rule = GetStepRule();
+  *w = (World){
+    .table = calloc(cap, sizeof(ChunkNode *)),
+    .capacity = cap,
+    .nodes = malloc(capacity * sizeof(ChunkNode *)),
+    .nodeCapacity = capacity,
+    .needsFullSave = true,
+    .states = rule.states,
+    .planes = (uint8_t)GetRuleDyingPlanes(rule),
+  };
+  InitChunkPool(&w->pool, sizeof(ChunkNode) + w->planes * sizeof(uint64_t));
+}
+
+void FreeWorld(World *w) {
+  if (w->periods) ClearPeriodObjects(w->periods);
+  FreeChunkPool(&w->pool);
+  free(w->table);
+  free(w->nodes);
+  free(w->active.items);
+  free(w->nextActive.items);
+  free(w->blinking.items);
+  free(w->removed);
+  *w = (World){ 0 };
+}
+
+void ClearWorld(World *w) {
+  if (w->periods) ClearPeriodObjects(w->periods);
+  ResetChunkPool(&w->pool);
+  memset(w->table, 0, w->capacity * sizeof(ChunkNode *));
+  w->count = 0;
+  w->active.count = 0;
+  w->nextActive.count = 0;
+  w->blinking.count = 0;
+  w->removedCount = 0;
+  w->needsFullSave = true;
+}
+
+ChunkNode *FindChunk(const World *w, int x, int y) {
+  uint32_t mask = w->capacity - 1;
+  for (uint32_t i = HashChunkCoords(x, y) & mask;; i = (i + 1) & mask) {
+    ChunkNode *node = w->table[i];
+    if (node == NULL || (node->x == x && node->y == y)) return node;
+  }
+}
+
+static void InsertIntoTable(ChunkNode **table, uint32_t capacity, ChunkNode *node) {
+  uint32_t mask = capacity - 1;
+  uint32_t i = HashChunkCoords(node->x, node->y) & mask;
+  while (table[i] != NULL) i = (i + 1) & mask;
+  table[i] = node;
+}
+
+static void ResizeTable(World *w, uint32_t capacity) {
+  ChunkNode **table = calloc(capacity, sizeof(ChunkNode *));
+  for (uint32_t i = 0; i < w->count; i++) InsertIntoTable(table, capacity, w->nodes[i]);
+  free(w->table);
+  w->table = table;
+  w->capacity = capacity;
+}
+
+void ReserveWorld(World *w, uint32_t count) {
+  uint32_t capacity = w->capacity;
+  while (count * 2 > capacity) capacity <<= 1;
+  if (capacity != w->capacity) ResizeTable(w, capacity);
+  if (count > w->nodeCapacity) {
+    w->nodeCapacity = count;
+    w->nodes = realloc(w->nodes, w->nodeCapacity * sizeof(ChunkNode *));
+  }
+}
+
+static void PushNode(NodeList *list, ChunkNode *node) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->items = realloc(list->items, list->capacity * sizeof(ChunkNode *));
+  }
+  list->items[list->count++] = node;
+}
+
+static void QueueChunk(NodeList *list, ChunkNode *node, uint64_t stamp) {
+  if (node->activeStamp == stamp) return;
+  node->activeStamp = stamp;
+  node->state = CHUNK_ACTIVE;
+  PushNode(list, node);
+}
+
+ChunkNode *GetOrCreateChunk(World *w, int x, int y) {
+  ChunkNode *node = FindChunk(w, x, y);
+  if (node) return node;
+
+  if ((w->count + 1) * 2 > w->capacity) ResizeTable(w, w->capacity * 2);
+  if (w->count == w->nodeCapacity) {
+    w->nodeCapacity = w->nodeCapacity ? w->nodeCapacity * 2 : 64;
+    w->nodes = realloc(w->nodes, w->nodeCapacity * sizeof(ChunkNode *));
+  }
+
+  // Placing the node in a neighbour's slab keeps a region's chunks close together in memory.
+  ChunkNode *neighbours[MAX_NEIGHBOURS];
+  ChunkNode *hint = NULL;
+  for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+    neighbours[n] = FindChunk(w, x + NEIGHBOUR_DX[n], y + NEIGHBOUR_DY[n]);
+    if (!hint) hint = neighbours[n];
+  }
+
+  node = AllocChunkSlot(&w->pool, hint);
+  node->x = x;
+  node->y = y;
+  node->index = w->count;
+  w->nodes[w->count++] = node;
+  InsertIntoTable(w->table, w->capacity, node);
+
+  for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+    node->Neighbours[n] = neighbours[n];
+    if (neighbours[n]) neighbours[n]->Neighbours[OPPOSITE(n)] = node;
+  }
+  QueueChunk(&w->active, node, w->generation + 1);
+  return node;
+}
+
+void WakeChunk(World *w, ChunkNode *node) {
+  // Already woken since the last step, so it and its neighbours are queued.
+  if (node->changed && node->activeStamp == w->generation + 1) return;
+  // Its history no longer predicts its future, so force one more active step around it.
+  node->changed = true;
+  QueueChunk(&w->active, node, w->generation + 1);
+  for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+    if (node->Neighbours[n]) QueueChunk(&w->active, node->Neighbours[n], w->generation + 1);
+  }
+}
+
+void SetWorldGeneration(World *w, uint64_t generation) {
+  // Queue stamps are relative to the generation, so only the chunks already queued keep a match.
+  for (uint32_t i = 0; i < w->count; i++) w->nodes[i]->activeStamp = 0;
+  for (uint32_t i = 0; i < w->active.count; i++) w->active.items[i]->activeStamp = generation + 1;
+  w->generation = generation;
+}
+
+uint64_t GetDyingCells(const World *w, const ChunkNode *node) {
+  uint64_t dying = 0;
+  for (int p = 0; p < w->planes; p++) dying |= node->dying[p];
+  return dying;
+}
+
+// SplitMix64's finaliser.
+static inline uint64_t MixHash(uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+uint64_t HashWorldChunk(int x, int y, uint64_t value) {
+  return MixHash(MixHash(((uint64_t)(uint32_t)x << 32 | (uint32_t)y) + 0x9e3779b97f4a7c15ULL) ^ value);
+}
+
+static void AddMoverHash(void *ctx, int x, int y, uint64_t value) {
+  *(uint64_t *)ctx += HashWorldChunk(x, y, value);
+}
+
+uint64_t HashWorld(const World *w) {
+  // Chunk hashes are summed, so the table order does not matter.
+  uint64_t hash = 0;
+  for (uint32_t i = 0; i < w->count; i++) {
+    const ChunkNode *node = w->nodes[i];
+    if (!node->c.chunk_value && !GetDyingCells(w, node)) continue;
+    if (w->halo && !IsHaloColumnOwned(w->halo, node->x)) continue;
+    uint64_t h = HashWorldChunk(node->x, node->y, node->c.chunk_value);
+    for (int p = 0; p < w->planes; p++) h = MixHash(h ^ node->dying[p]);
+    hash += h;
+  }
+  // Movers never share a chunk with the world, so their chunks add up the same as on the grid.
+  if (w->periods) VisitPeriodMovers(w->periods, w->generation, AddMoverHash, &hash);
+  return hash;
+}
+
+void SetChunkValue(World *w, int x, int y, uint64_t value) {
+  ChunkNode *node = value ? GetOrCreateChunk(w, x, y) : FindChunk(w, x, y);
+  if (!node || node->c.chunk_value == value) return;
+  node->c.chunk_value = value;
+  for (int p = 0; p < w->planes; p++) node->dying[p] &= ~value;
+  WakeChunk(w, node);
+}
+
+// Only called on sleeping nodes, which are on neither the active nor the blinking list.
+static void RemoveChunk(World *w, ChunkNode *node) {
+  for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+    if (node->Neighbours[n]) node->Neighbours[n]->Neighbours[OPPOSITE(n)] = NULL;
+  }
+
+  // Backward-shift deletion keeps probe chains intact without tombstones.
+  uint32_t mask = w->capacity - 1;
+  uint32_t i = HashChunkCoords(node->x, node->y) & mask;
+  while (w->table[i] != node) i = (i + 1) & mask;
+  for (uint32_t j = (i + 1) & mask; w->table[j] != NULL; j = (j + 1) & mask) {
+    uint32_t home = HashChunkCoords(w->table[j]->x, w->table[j]->y) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      w->table[i] = w->table[j];
+      i = j;
+    }
+  }
+  w->table[i] = NULL;
+
+  if (node->saved) {
+    if (w->removedCount == w->removedCapacity) {
+      w->removedCapacity = w->removedCapacity ? w->removedCapacity * 2 : 64;
+      w->removed = realloc(w->removed, w->removedCapacity * sizeof(ChunkCoord));
+    }
+    w->removed[w->removedCount++] = (ChunkCoord){ node->x, node->y };
+  }
+
+  ChunkNode *last = w->nodes[--w->count];
+  last->index = node->index;
+  w->nodes[node->index] = last;
+  FreeChunkSlot(&w->pool, node);
+}
+
+static inline int FloorDiv(int64_t a, int b) {
+  return (int)((a >= 0 ? a : a - (b - 1)) / b);
+}
+
+void SetWorldCell(World *w, int64_t x, int64_t y, bool alive) {
+  int cx = FloorDiv(x, CHUNK_SIZE);
+  int cy = FloorDiv(y, CHUNK_SIZE);
+  uint64_t bit = 1ULL << ((y - (int64_t)cy * CHUNK_SIZE) * BLOCK_SIZE + (x - (int64_t)cx * CHUNK_SIZE));
+  ChunkNode *node = alive ? GetOrCreateChunk(w, cx, cy) : FindChunk(w, cx, cy);
+  if (!node) return;
+  uint64_t value = alive ? node->c.chunk_value | bit : node->c.chunk_value & ~bit;
+  if (value == node->c.chunk_value) return;
+  node->c.chunk_value = value;
+  for (int p = 0; p < w->planes; p++) node->dying[p] &= ~value;
+  WakeChunk(w, node);
+}
+
+bool GetWorldCell(const World *w, int64_t x, int64_t y) {
+  int cx = FloorDiv(x, CHUNK_SIZE);
+  int cy = FloorDiv(y, CHUNK_SIZE);
+  ChunkNode *node = FindChunk(w, cx, cy);
+  if (!node) return false;
+  return GetCell(node->c.chunk_value, (y - (int64_t)cy * CHUNK_SIZE) * BLOCK_SIZE + (x - (int64_t)cx * CHUNK_SIZE));
+}
+
+void SetWorldCellState(World *w, int64_t x, int64_t y, int state) {
+  if (state < 0 || state >= w->states) return;
+  int cx = FloorDiv(x, CHUNK_SIZE);
+  int cy = FloorDiv(y, CHUNK_SIZE);
+  uint64_t bit = 1ULL << ((y - (int64_t)cy * CHUNK_SIZE) * BLOCK_SIZE + (x - (int64_t)cx * CHUNK_SIZE));
+  ChunkNode *node = state ? GetOrCreateChunk(w, cx, cy) : FindChunk(w, cx, cy);
+  if (!node) return;
+  node->c.chunk_value = state == 1 ? node->c.chunk_value | bit : node->c.chunk_value & ~bit;
+  int age = state > 1 ? state - 1 : 0;
+  for (int p = 0; p < w->planes; p++)
+    node->dying[p] = (age >> p) & 1 ? node->dying[p] | bit : node->dying[p] & ~bit;
+  WakeChunk(w, node);
+}
+
+int GetWorldCellState(const World *w, int64_t x, int64_t y) {
+  int cx = FloorDiv(x, CHUNK_SIZE);
+  int cy = FloorDiv(y, CHUNK_SIZE);
+  ChunkNode *node = FindChunk(w, cx, cy);
+  if (!node) return 0;
+  int i = (int)((y - (int64_t)cy * CHUNK_SIZE) * BLOCK_SIZE + (x - (int64_t)cx * CHUNK_SIZE));
+  if (GetCell(node->c.chunk_value, i)) return 1;
+  int age = 0;
+  for (int p = 0; p < w->planes; p++) age |= (int)GetCell(node->dying[p], i) << p;
+  return age ? age + 1 : 0;
+}
+
+// An empty chunk can be freed once no neighbour has live cells on the shared edge.
+static bool IsChunkIdle(const ChunkNode *node) {
+  if (node->c.chunk_value) return false;
+  for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+    const ChunkNode *other = node->Neighbours[n];
+    if (other && (other->c.chunk_value & NEIGHBOUR_EDGE[OPPOSITE(n)])) return false;
+  }
+  return true;
+}
+
+typedef struct StepRange {
+  World *w;
+  uint32_t first; // Offset into the active list
+} StepRange;
+
+// Chunks are gathered STEP_LANES at a time into a ChunkLanes block so the SIMD kernels can step
+// them side by side; a short tail is padded with empty lanes.
+static void StepChunkRange(void *ctx, uint32_t begin, uint32_t end) {
+  const StepRange *range = ctx;
+  World *w = range->w;
+  begin += range->first;
+  end += range->first;
+  ChunkLanes lanes;
+  uint64_t next[STEP_LANES];
+  for (uint32_t i = begin; i < end; i += STEP_LANES) {
+    uint32_t count = end - i < STEP_LANES ? end - i : STEP_LANES;
+    for (uint32_t l = 0; l < STEP_LANES; l++) {
+      ChunkNode *node = l < count ? w->active.items[i + l] : NULL;
+      lanes.c[l] = node ? node->c.chunk_value : 0;
+      for (int k = 0; k < MAX_NEIGHBOURS; k++)
+        lanes.n[k][l] = node && node->Neighbours[k] ? node->Neighbours[k]->c.chunk_value : 0;
+    }
+    StepChunkLanes(&lanes, next);
+    for (uint32_t l = 0; l < count; l++) w->active.items[i + l]->next.chunk_value = next[l];
+  }
+}
+
+// Dying planes only depend on the node itself, so they are aged here rather than in the kernels;
+// a dying cell cannot be born until it has fully decayed.
+static void CommitChunkRange(void *ctx, uint32_t begin, uint32_t end) {
+  World *w = ctx;
+  for (uint32_t i = begin; i < end; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (w->planes) {
+      uint64_t dying = GetDyingCells(w, node);
+      node->decaying = dying != 0;
+      node->next.chunk_value &= ~dying;
+      AdvanceDyingPlanes(node->dying, w->planes, w->states, node->c.chunk_value, node->next.chunk_value);
+    }
+    if (node->next.chunk_value != node->prev.chunk_value) node->changed = true;
+    node->prev = node->c;
+    node->c = node->next;
+  }
+}
+
+static void BlinkChunkRange(void *ctx, uint32_t begin, uint32_t end) {
+  World *w = ctx;
+  for (uint32_t i = begin; i < end; i++) {
+    ChunkNode *node = w->blinking.items[i];
+    if (node->state != CHUNK_BLINKING) continue;
+    Chunk c = node->c;
+    node->c = node->prev;
+    node->prev = c;
+  }
+}
+
+uint32_t StepWorld(World *w) {
+  uint64_t stamp = w->generation + 1;
+
+  // Make room for births across borders before stepping; new chunks start empty and active.
+  // Sleeping chunks already grew their neighbours while they were active. Halo ghosts never step.
+  uint32_t count = w->active.count;
+  for (uint32_t i = 0; i < count; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (w->halo && !IsHaloColumnOwned(w->halo, node->x)) continue;
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      if (!node->Neighbours[n] && (node->c.chunk_value & NEIGHBOUR_EDGE[n]))
+        GetOrCreateChunk(w, node->x + NEIGHBOUR_DX[n], node->y + NEIGHBOUR_DY[n]);
+    }
+  }
+
+  // All passes only write the chunks they own: the step reads c and writes next, the commits
+  // rotate each node's own buffers, so workers never need a lock inside a generation. A halo
+  // exchange steps the interior first, while the peers' edges are on their way.
+  uint32_t interior = w->halo ? BeginHaloExchange(w) : w->active.count;
+  RunParallel(w->scheduler, interior, STEP_BATCH, StepChunkRange, &(StepRange){ w, 0 });
+  if (w->halo) {
+    FinishHaloExchange(w, interior);
+    RunParallel(w->scheduler, w->active.count - interior, STEP_BATCH, StepChunkRange, &(StepRange){ w, interior });
+  }
+  uint32_t stepped = w->active.count;
+  RunParallel(w->scheduler, stepped, STEP_BATCH, CommitChunkRange, w);
+  RunParallel(w->scheduler, w->blinking.count, STEP_BATCH, BlinkChunkRange, w);
+  if (w->periods) CyclePeriodOscillators(w);
+
+  // Next generation steps every chunk that changed, and everything around it.
+  w->nextActive.count = 0;
+  for (uint32_t i = 0; i < stepped; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (!node->changed) {
+      // Cells whose last dying state just expired could not be born this step, so the next one
+      // must look at them even though nothing around them changed.
+      if (w->planes && (node->decaying || GetDyingCells(w, node))) QueueChunk(&w->nextActive, node, stamp + 1);
+      continue;
+    }
+    node->changed = false;
+    QueueChunk(&w->nextActive, node, stamp + 1);
+    for (int n = 0; n < MAX_NEIGHBOURS; n++) {
+      if (node->Neighbours[n]) QueueChunk(&w->nextActive, node->Neighbours[n], stamp + 1);
+    }
+  }
+
+  // Drop blinkers that were woken up, then put the settled chunks to sleep.
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < w->blinking.count; i++) {
+    if (w->blinking.items[i]->state == CHUNK_BLINKING) w->blinking.items[kept++] = w->blinking.items[i];
+  }
+  w->blinking.count = kept;
+
+  for (uint32_t i = 0; i < stepped; i++) {
+    ChunkNode *node = w->active.items[i];
+    if (node->activeStamp == stamp + 1) continue;
+    if (node->c.chunk_value != node->prev.chunk_value) {
+      node->state = CHUNK_BLINKING;
+      PushNode(&w->blinking, node);
+    } else if (!node->periodic && IsChunkIdle(node)) {
+      RemoveChunk(w, node);
+    } else {
+      node->state = CHUNK_ASLEEP;
+    }
+  }
+
+  NodeList done = w->active;
+  w->active = w->nextActive;
+  w->nextActive = done;
+  w->generation++;
+  if (w->periods) UpdatePeriodTracker(w);
+  return stepped;
+}
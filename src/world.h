@@ -0,0 +1,117 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "chunk.h"
+#include "chunkpool.h"
+#include "scheduler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  CHUNK_ACTIVE,   // Stepped every generation
+  CHUNK_ASLEEP,   // Period 1: left untouched
+  CHUNK_BLINKING, // Period 2: c and prev are swapped each generation instead of stepping
+  CHUNK_CYCLING   // Part of a longer oscillator whose phases are replayed from a table, see period.h
+} ChunkState;
+
+typedef struct ChunkNode ChunkNode;
+struct ChunkNode {
+  Chunk c;
+  Chunk next;
+  Chunk prev; // Value one generation ago
+  ChunkNode *Neighbours[MAX_NEIGHBOURS];
+  int x, y;
+  uint32_t index; // Position in World.nodes
+  uint64_t activeStamp; // generation + 1 of the step this node is queued for
+  uint64_t saved; // Value in the last checkpoint, see snapshot.h
+  uint8_t state;
+  bool changed; // Differs from two generations ago, or was edited since the last step
+  bool periodic; // Belongs to a PeriodOscillator, which holds on to it, so it is never freed
+  bool decaying; // Had dying cells before the last step aged them
+  uint64_t dying[]; // World.planes planes of dying-cell ages, see AdvanceDyingPlanes
+};
+
+typedef struct ChunkCoord {
+  int32_t x, y;
+} ChunkCoord;
+
+struct PeriodTracker;
+struct HaloExchange;
+
+typedef struct NodeList {
+  ChunkNode **items;
+  uint32_t count;
+  uint32_t capacity;
+} NodeList;
+
+// Sparse, unbounded world: an open-addressing (linear probing) table from chunk coordinates to
+// nodes allocated from a slab pool, plus a dense list for iteration. Nodes never move, so the neighbour
+// pointers cached in each node stay valid while the table grows.
+//
+// Only chunks on the active list are stepped. A chunk is active while it or a neighbour differs
+// from two generations ago; otherwise its next value is already known (its own value for period
+// 1, the previous one for period 2) and it sleeps until a neighbour changes again.
+//
+// Under a Generations rule each node also carries the dying planes. Dying cells do not affect
+// neighbours, so a chunk with dying cells stays active without waking the chunks around it.
+typedef struct World {
+  ChunkNode **table;
+  uint32_t capacity; // Power of two
+  ChunkNode **nodes;
+  uint32_t count;
+  uint32_t nodeCapacity;
+  NodeList active;
+  NodeList nextActive;
+  NodeList blinking;
+  ChunkPool pool;
+  // Chunks removed since the last checkpoint while they still had cells on disk. ClearWorld
+  // loses that information, so it sets needsFullSave instead.
+  ChunkCoord *removed;
+  uint32_t removedCount;
+  uint32_t removedCapacity;
+  bool needsFullSave;
+  uint64_t generation;
+  Scheduler *scheduler; // Optional; NULL steps on the calling thread
+  struct PeriodTracker *periods; // Optional oscillator and spaceship tracking, see period.h
+  struct HaloExchange *halo; // Optional strip of a world split across processes, see halo.h
+  uint16_t states; // Rule.states when the world was created
+  uint8_t planes; // Dying planes per node, 0 for two-state rules
+} World;
+
+// Chunks handed to a worker at a time; small enough to balance, large enough to amortise claims.
+#define STEP_BATCH 256
+
+// The node layout depends on the step rule's state count, so set the rule first.
+void InitWorld(World *w, uint32_t capacity);
+void FreeWorld(World *w);
+// Frees every chunk but keeps the table, scheduler and generation counter.
+void ClearWorld(World *w);
+// Sizes the table and node list for count chunks, so bulk loads do not rehash repeatedly.
+void ReserveWorld(World *w, uint32_t count);
+ChunkNode *FindChunk(const World *w, int x, int y);
+ChunkNode *GetOrCreateChunk(World *w, int x, int y);
+// Call after writing a node's c directly, so it and its neighbours get stepped again.
+void WakeChunk(World *w, ChunkNode *node);
+// Moves the generation counter between steps. Set it before loading cells, not after, or their
+// chunks may be queued twice for the next step.
+void SetWorldGeneration(World *w, uint64_t generation);
+// Sets the live plane; cells made live stop dying.
+void SetChunkValue(World *w, int x, int y, uint64_t value);
+void SetWorldCell(World *w, int64_t x, int64_t y, bool alive);
+bool GetWorldCell(const World *w, int64_t x, int64_t y);
+// Cell states as in Rule: 0 dead, 1 live, 2 .. states-1 dying. Out-of-range states are ignored.
+void SetWorldCellState(World *w, int64_t x, int64_t y, int state);
+int GetWorldCellState(const World *w, int64_t x, int64_t y);
+// OR of the node's dying planes: the cells in any dying state.
+uint64_t GetDyingCells(const World *w, const ChunkNode *node);
+// One chunk's term in HashWorld, which is the sum over the non-empty chunks.
+uint64_t HashWorldChunk(int x, int y, uint64_t value);
+// 64-bit hash of every cell's state and position. It does not depend on chunk order, empty
+// chunks, threads or step kernel, so equal worlds hash equally across runs and builds. With a
+// halo exchange it covers the owned strip only, and the strips' hashes add up to the whole world's.
+uint64_t HashWorld(const World *w);
+// Advances the world one generation and returns the number of chunks stepped.
+uint32_t StepWorld(World *w);
+
+#endif